@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <QChar>
+#include <QStringView>
+
+namespace Qtmotion {
+// Jump targets as parallel arrays of positions and the keys that select them, with every selector
+// packed into one buffer. Clearing keeps the capacity, so a set refilled on every keystroke stops
+// allocating once it has grown to fit.
+class CandidateSet {
+ public:
+  // Views the set's own storage, so only valid until it next changes
+  struct Candidate {
+    int position;
+    QStringView selector;
+  };
+
+  class Iterator {
+   public:
+    Iterator(const CandidateSet& set, const size_t index) : set_(&set), index_(index) {}
+
+    Candidate operator*() const {
+      return (*set_)[index_];
+    }
+
+    Iterator& operator++() {
+      index_++;
+      return *this;
+    }
+
+    bool operator!=(const Iterator& other) const {
+      return index_ != other.index_;
+    }
+
+   private:
+    const CandidateSet* set_;
+    size_t index_;
+  };
+
+  void clear() {
+    positions_.clear();
+    selectorEnds_.clear();
+    keys_.clear();
+  }
+
+  void push(const int position, const QStringView selector) {
+    positions_.push_back(position);
+    keys_.insert(keys_.end(), selector.utf16(), selector.utf16() + selector.size());
+    selectorEnds_.push_back(uint32_t(keys_.size()));
+  }
+
+  void push(const int position, const QChar selector) {
+    push(position, QStringView(&selector, 1));
+  }
+
+  size_t size() const {
+    return positions_.size();
+  }
+
+  bool empty() const {
+    return positions_.empty();
+  }
+
+  int position(const size_t i) const {
+    return positions_[i];
+  }
+
+  QStringView selector(const size_t i) const {
+    const uint32_t start = i == 0 ? 0 : selectorEnds_[i - 1];
+    return QStringView(keys_.data() + start, selectorEnds_[i] - start);
+  }
+
+  Candidate operator[](const size_t i) const {
+    return Candidate{.position = position(i), .selector = selector(i)};
+  }
+
+  Candidate front() const {
+    return (*this)[0];
+  }
+
+  Iterator begin() const {
+    return Iterator(*this, 0);
+  }
+
+  Iterator end() const {
+    return Iterator(*this, size());
+  }
+
+ private:
+  std::vector<int> positions_;
+  // Where each selector ends in keys_, which is where the next one starts
+  std::vector<uint32_t> selectorEnds_;
+  std::vector<char16_t> keys_;
+};
+} // namespace Qtmotion
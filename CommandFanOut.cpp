@@ -0,0 +1,153 @@
+#include "CommandFanOut.h"
+
+#include <algorithm>
+
+#include <coreplugin/messagemanager.h>
+#include <coreplugin/progressmanager/progressmanager.h>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+
+#include "CommandRunner.h"
+
+namespace Qtmotion {
+CommandFanOut::CommandFanOut() {
+  // Cancelling the batch's task stops the runs in flight and drops the rest
+  connect(&progressWatcher_, &QFutureWatcherBase::canceled, this, &CommandFanOut::cancel);
+}
+
+CommandFanOut::~CommandFanOut() {
+  if (active_ > 0) {
+    retireRunners();
+    progress_.reportFinished();
+  }
+}
+
+void CommandFanOut::run(
+    const QString& command,
+    const QStringList& files,
+    const std::chrono::milliseconds timeout) {
+  if (active_ > 0) {
+    // The runners take whatever they were running down with them, in their own time
+    retireRunners();
+    active_ = 0;
+    progress_.reportCanceled();
+    progress_.reportFinished();
+  }
+
+  QSet<QString> seen;
+  queue_.clear();
+
+  for (const QString& file : files) {
+    const QFileInfo info(file);
+    const QString canonical = info.canonicalFilePath();
+    const QString path =
+        canonical.isEmpty() ? QDir::cleanPath(info.absoluteFilePath()) : canonical;
+
+    if (!file.isEmpty() && !seen.contains(path)) {
+      seen.insert(path);
+      queue_.push_back(path);
+    }
+  }
+
+  command_ = command;
+  total_ = int(queue_.size());
+  done_ = 0;
+  failed_ = 0;
+
+  if (total_ == 0) {
+    Core::MessageManager::writeFlashing(tr("No files to run %1 on").arg(command));
+    return;
+  }
+
+  progress_ = QFutureInterface<void>();
+  progress_.setProgressRange(0, total_);
+  progress_.reportStarted();
+  progressWatcher_.setFuture(progress_.future());
+  Core::ProgressManager::addTask(progress_.future(), tr("Command"), Utils::Id("Command"));
+
+  const size_t numRunners = size_t(std::min(total_, std::max(1, QThread::idealThreadCount())));
+
+  while (runners_.size() < numRunners) {
+    auto runner = std::make_unique<CommandRunner>();
+    runner->setShowsProgress(false);
+
+    CommandRunner* raw = runner.get();
+    connect(raw, &CommandRunner::finished, this, [this, raw](const int exitCode) {
+      onRunFinished(*raw, exitCode);
+    });
+
+    runners_.push_back(std::move(runner));
+  }
+
+  wallTime_.start();
+
+  for (size_t i = 0; i < numRunners; i++) {
+    runners_[i]->setTimeout(timeout);
+    startNext(*runners_[i]);
+  }
+}
+
+void CommandFanOut::cancel() {
+  queue_.clear();
+
+  for (const auto& runner : runners_) {
+    runner->cancel();
+  }
+}
+
+void CommandFanOut::retireRunners() {
+  for (std::unique_ptr<CommandRunner>& runner : runners_) {
+    runner->disconnect(this);
+
+    if (runner->isRunning()) {
+      CommandRunner* retired = runner.release();
+      connect(retired, &CommandRunner::finished, retired, &QObject::deleteLater);
+      retired->cancel();
+    }
+  }
+
+  runners_.clear();
+}
+
+void CommandFanOut::startNext(CommandRunner& runner) {
+  if (queue_.isEmpty()) {
+    return;
+  }
+
+  active_++;
+  runner.run(command_ + ' ' + CommandRunner::shellQuote(queue_.takeFirst()));
+}
+
+void CommandFanOut::onRunFinished(CommandRunner& runner, const int exitCode) {
+  active_--;
+  done_++;
+
+  if (exitCode != 0) {
+    failed_++;
+  }
+
+  progress_.setProgressValue(done_);
+
+  startNext(runner);
+
+  if (active_ == 0) {
+    const QString summary = tr("%1 ran on %2 of %3 files in %4 s, %5 failed")
+                                .arg(command_)
+                                .arg(done_)
+                                .arg(total_)
+                                .arg(wallTime_.elapsed() / 1000.0, 0, 'f', 2)
+                                .arg(failed_);
+
+    if (failed_ == 0 && done_ == total_) {
+      Core::MessageManager::writeSilently(summary);
+    } else {
+      Core::MessageManager::writeFlashing(summary);
+    }
+
+    progress_.reportFinished();
+  }
+}
+} // namespace Qtmotion
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QStringList>
+
+namespace Qtmotion {
+class CommandRunner;
+
+// Runs a command once per file across a pool of runners, one per core, behind a single task in
+// the progress bar that counts the files done
+class CommandFanOut : public QObject {
+  Q_OBJECT
+
+ public:
+  CommandFanOut();
+  ~CommandFanOut() override;
+
+  // Runs command with each file appended, cancelling any batch already going. Files that resolve
+  // to the same path only run once, and each run is cancelled after timeout unless that's zero.
+  void run(const QString& command, const QStringList& files, std::chrono::milliseconds timeout);
+
+  void cancel();
+
+ private:
+  // Hands the runner the next file in the queue, if any are left
+  void startNext(CommandRunner& runner);
+
+  void onRunFinished(CommandRunner& runner, int exitCode);
+
+  // Lets go of every runner, cancelling those still running and deleting them once their commands
+  // have died, rather than waiting here for each one to be killed
+  void retireRunners();
+
+  QString command_;
+  QStringList queue_;
+  int total_ = 0;
+  int done_ = 0;
+  int failed_ = 0;
+  int active_ = 0;
+  QFutureInterface<void> progress_;
+  QFutureWatcher<void> progressWatcher_;
+  QElapsedTimer wallTime_;
+  std::vector<std::unique_ptr<CommandRunner>> runners_;
+};
+} // namespace Qtmotion
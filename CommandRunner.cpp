@@ -0,0 +1,236 @@
+#include "CommandRunner.h"
+
+#include <algorithm>
+
+#include <coreplugin/messagemanager.h>
+#include <coreplugin/progressmanager/progressmanager.h>
+
+#ifndef Q_OS_WIN
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+namespace Qtmotion {
+CommandRunner::CommandRunner() {
+  killTimer_.setSingleShot(true);
+  killTimer_.setInterval(kKillGraceMs_);
+  connect(&killTimer_, &QTimer::timeout, this, [this] {
+    if (isRunning()) {
+      signalProcessTree(*process_, true);
+    }
+  });
+
+  timeoutTimer_.setSingleShot(true);
+  connect(&timeoutTimer_, &QTimer::timeout, this, [this] {
+    timedOut_ = true;
+    cancel();
+  });
+
+  // Cancelling the task in the progress bar is how a command gets stopped
+  connect(&progressWatcher_, &QFutureWatcherBase::canceled, this, &CommandRunner::cancel);
+}
+
+CommandRunner::~CommandRunner() {
+  if (isRunning()) {
+    process_->disconnect(this);
+    signalProcessTree(*process_, true);
+    process_->waitForFinished(kKillGraceMs_);
+    progress_.reportFinished();
+  }
+}
+
+void CommandRunner::run(const QString& command) {
+  if (isRunning()) {
+    // The old command says nothing more, and its process goes once it has died
+    QProcess* old = process_.release();
+    old->disconnect(this);
+    connect(old, &QProcess::finished, old, &QObject::deleteLater);
+    signalProcessTree(*old, true);
+    finish(tr("was superseded"), -1);
+  }
+
+  command_ = command;
+  cancelled_ = false;
+  timedOut_ = false;
+  outputDecoder_ = QStringDecoder(QStringDecoder::System);
+  errorDecoder_ = QStringDecoder(QStringDecoder::System);
+  pendingOutput_.clear();
+  pendingError_.clear();
+  bucket_ = 0;
+  bucketBytes_ = 0;
+  peakBytesPerSecond_ = 0;
+
+  process_ = std::make_unique<QProcess>();
+
+#ifdef Q_OS_WIN
+  process_->setProgram("cmd.exe");
+  process_->setNativeArguments("/c " + command);
+#else
+  process_->setProgram("/bin/sh");
+  process_->setArguments({"-c", command});
+
+  // Leading its own process group lets a cancel reach everything the command starts
+  process_->setChildProcessModifier([] { ::setpgid(0, 0); });
+#endif
+
+  connect(process_.get(), &QProcess::readyReadStandardOutput, this, [this] { readOutput(false); });
+  connect(process_.get(), &QProcess::readyReadStandardError, this, [this] { readOutput(false); });
+  connect(process_.get(), &QProcess::finished, this, &CommandRunner::onFinished);
+  connect(process_.get(), &QProcess::errorOccurred, this, &CommandRunner::onErrorOccurred);
+
+  // There's no telling how far along a command is, so its task shows as busy until it exits
+  progress_ = QFutureInterface<void>();
+  progress_.setProgressRange(0, 0);
+  progress_.reportStarted();
+  progressWatcher_.setFuture(progress_.future());
+
+  if (showsProgress_) {
+    Core::ProgressManager::addTask(progress_.future(), tr("Command"), Utils::Id("Command"));
+  }
+
+  if (timeoutTimer_.interval() > 0) {
+    timeoutTimer_.start();
+  }
+
+  Core::MessageManager::writeSilently(tr("Running %1").arg(command));
+
+  wallTime_.start();
+  process_->start();
+}
+
+bool CommandRunner::isRunning() const {
+  return process_ && process_->state() != QProcess::NotRunning;
+}
+
+QString CommandRunner::shellQuote(QString path) {
+#ifdef Q_OS_WIN
+  return '"' + path + '"';
+#else
+  return '\'' + path.replace("'", "'\\''") + '\'';
+#endif
+}
+
+void CommandRunner::setShowsProgress(const bool enabled) {
+  showsProgress_ = enabled;
+}
+
+void CommandRunner::setTimeout(const std::chrono::milliseconds timeout) {
+  timeoutTimer_.setInterval(timeout);
+}
+
+void CommandRunner::cancel() {
+  if (!isRunning() || cancelled_) {
+    return;
+  }
+
+  cancelled_ = true;
+  signalProcessTree(*process_, false);
+  killTimer_.start();
+}
+
+void CommandRunner::readOutput(const bool flush) {
+  const QByteArray output = process_->readAllStandardOutput();
+  const QByteArray error = process_->readAllStandardError();
+
+  const qint64 bucket = wallTime_.elapsed() / 1000;
+
+  if (bucket != bucket_) {
+    bucket_ = bucket;
+    bucketBytes_ = 0;
+  }
+
+  bucketBytes_ += output.size() + error.size();
+  peakBytesPerSecond_ = std::max(peakBytesPerSecond_, bucketBytes_);
+
+  writeLines(pendingOutput_, outputDecoder_.decode(output), flush);
+  writeLines(pendingError_, errorDecoder_.decode(error), flush);
+}
+
+void CommandRunner::writeLines(QString& pending, const QString& text, const bool flush) {
+  pending += text;
+
+  const qsizetype end = flush ? pending.size() : pending.lastIndexOf(QLatin1Char('\n')) + 1;
+
+  if (end == 0) {
+    return;
+  }
+
+  // Every message gets its own line in the pane
+  QString lines = pending.left(end);
+
+  if (lines.endsWith(QLatin1Char('\n'))) {
+    lines.chop(1);
+  }
+
+  Core::MessageManager::writeSilently(lines);
+  pending.remove(0, end);
+}
+
+void CommandRunner::onFinished(const int exitCode, const QProcess::ExitStatus status) {
+  // Whatever the command printed last, even without a newline
+  readOutput(true);
+
+  // Let go first, as whoever hears finished() may start the next run straight away
+  process_->disconnect(this);
+  process_.release()->deleteLater();
+
+  if (timedOut_) {
+    finish(tr("timed out"), -1);
+  } else if (cancelled_) {
+    finish(tr("was cancelled"), -1);
+  } else if (status == QProcess::CrashExit) {
+    finish(tr("crashed"), -1);
+  } else {
+    finish(tr("exited with code %1").arg(exitCode), exitCode);
+  }
+}
+
+void CommandRunner::onErrorOccurred(const QProcess::ProcessError error) {
+  // Anything else is followed by finished()
+  if (error == QProcess::FailedToStart) {
+    const QString reason = process_->errorString();
+    process_.release()->deleteLater();
+    finish(tr("failed to start: %1").arg(reason), -1);
+  }
+}
+
+void CommandRunner::finish(const QString& outcome, const int exitCode) {
+  killTimer_.stop();
+  timeoutTimer_.stop();
+
+  const QString summary = tr("%1 %2 after %3 s, peak output %4 KB/s")
+                              .arg(command_, outcome)
+                              .arg(wallTime_.elapsed() / 1000.0, 0, 'f', 2)
+                              .arg(peakBytesPerSecond_ / 1024.0, 0, 'f', 1);
+
+  if (exitCode == 0) {
+    Core::MessageManager::writeSilently(summary);
+  } else {
+    Core::MessageManager::writeFlashing(summary);
+  }
+
+  progress_.reportFinished();
+
+  emit finished(exitCode);
+}
+
+void CommandRunner::signalProcessTree(const QProcess& process, const bool kill) {
+  const qint64 pid = process.processId();
+
+  if (pid <= 0) {
+    return;
+  }
+
+#ifdef Q_OS_WIN
+  QStringList arguments = {"/T", "/PID", QString::number(pid)};
+
+  if (kill) {
+    arguments.prepend("/F");
+  }
+
+  QProcess::startDetached("taskkill", arguments);
+#else
+  ::kill(-pid_t(pid), kill ? SIGKILL : SIGTERM);
+#endif
+}
+} // namespace Qtmotion
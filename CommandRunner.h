@@ -0,0 +1,84 @@
+#pragma once
+
+#include <chrono>
+#include <memory>
+
+#include <QElapsedTimer>
+#include <QFutureInterface>
+#include <QFutureWatcher>
+#include <QObject>
+#include <QProcess>
+#include <QStringDecoder>
+#include <QTimer>
+
+namespace Qtmotion {
+// Runs a shell command without tying up a thread. Its output streams to the General Messages pane
+// as it arrives, and it shows as a task in the progress bar that cancels the whole process tree.
+class CommandRunner : public QObject {
+  Q_OBJECT
+
+ public:
+  CommandRunner();
+  ~CommandRunner() override;
+
+  // Starts command through the shell, cancelling whatever this runner was already running
+  void run(const QString& command);
+
+  bool isRunning() const;
+
+  // Keeps a path with spaces or quotes in it as one argument to the shell commands run through
+  static QString shellQuote(QString path);
+
+  // Whether runs show as their own task in the progress bar, for when something else reports on
+  // a batch of them
+  void setShowsProgress(bool enabled);
+
+  // Cancels runs that take longer than timeout, zero meaning never
+  void setTimeout(std::chrono::milliseconds timeout);
+
+  // Asks the command and everything it started to stop, then kills them if they don't
+  void cancel();
+
+ signals:
+  void finished(int exitCode);
+
+ private:
+  void readOutput(bool flush);
+
+  // Writes out whole lines, keeping back a partial last line until the rest of it arrives
+  static void writeLines(QString& pending, const QString& text, bool flush);
+
+  void onFinished(int exitCode, QProcess::ExitStatus status);
+
+  void onErrorOccurred(QProcess::ProcessError error);
+
+  // Reports how the run went and ends its progress task
+  void finish(const QString& outcome, int exitCode);
+
+  // Terminates or kills the process and everything it started
+  static void signalProcessTree(const QProcess& process, bool kill);
+
+  // How long a cancelled command has to exit before it is killed
+  static constexpr int kKillGraceMs_ = 2000;
+
+  std::unique_ptr<QProcess> process_;
+  QString command_;
+  QFutureInterface<void> progress_;
+  QFutureWatcher<void> progressWatcher_;
+  QTimer killTimer_;
+  QTimer timeoutTimer_;
+  bool showsProgress_ = true;
+  QElapsedTimer wallTime_;
+  QStringDecoder outputDecoder_;
+  QStringDecoder errorDecoder_;
+  QString pendingOutput_;
+  QString pendingError_;
+
+  // Output is counted in one second buckets to find its peak rate
+  qint64 bucket_ = 0;
+  qint64 bucketBytes_ = 0;
+  qint64 peakBytesPerSecond_ = 0;
+  bool cancelled_ = false;
+  bool timedOut_ = false;
+};
+} // namespace Qtmotion
@@ -0,0 +1,181 @@
+#include "DocumentIndex.h"
+
+#include <algorithm>
+
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QThreadPool>
+
+#include "MatchKernel.h"
+#include "Trace.h"
+
+namespace Qtmotion {
+namespace {
+// Lists grow by doubling, so allow for them holding up to twice what they use
+qint64 indexCost(const int characterCount) {
+  return 2 * qint64(characterCount) * qint64(sizeof(int));
+}
+
+// A single thread, so each document's jobs run in the order they were queued
+struct Worker : QThreadPool {
+  Worker() {
+    setMaxThreadCount(1);
+  }
+};
+
+QThreadPool& worker() {
+  static Worker worker;
+  return worker;
+}
+} // namespace
+
+DocumentIndex* DocumentIndex::attach(QTextDocument* document, const qint64 budgetBytes) {
+  DocumentIndex* index =
+      document->findChild<DocumentIndex*>(QString(), Qt::FindDirectChildrenOnly);
+
+  const qint64 cost = std::max(
+      indexCost(document->characterCount()), index ? index->state_->heldBytes.load() : 0);
+
+  if (cost > budgetBytes) {
+    delete index;
+    return nullptr;
+  }
+
+  if (index == nullptr) {
+    index = new DocumentIndex(document, budgetBytes);
+  }
+
+  index->budgetBytes_ = budgetBytes;
+  return index;
+}
+
+DocumentIndex::DocumentIndex(QTextDocument* document, const qint64 budgetBytes)
+    : QObject(document), document_(document), budgetBytes_(budgetBytes) {
+  connect(document, &QTextDocument::contentsChange, this, &DocumentIndex::onContentsChange);
+
+  rebuild();
+}
+
+bool DocumentIndex::isIdle() const {
+  return state_->pending == 0;
+}
+
+std::vector<int> DocumentIndex::positions(
+    const char16_t key,
+    const std::vector<TextSpan>& spans) const {
+  std::vector<int> found;
+  const auto list = state_->positions.find(key);
+
+  if (list == state_->positions.end()) {
+    return found;
+  }
+
+  for (const TextSpan& span : spans) {
+    const auto first = std::lower_bound(list->second.begin(), list->second.end(), span.start);
+    const auto last = std::upper_bound(first, list->second.end(), span.end);
+    found.insert(found.end(), first, last);
+  }
+
+  return found;
+}
+
+void DocumentIndex::onContentsChange(const int position, const int removed, const int added) {
+  // Highlighting and other format changes are reported too, without touching the text
+  if (removed == added && document_->revision() == revision_) {
+    return;
+  }
+
+  revision_ = document_->revision();
+
+  if (std::max(indexCost(document_->characterCount()), state_->heldBytes.load()) > budgetBytes_) {
+    // Grown too big to keep, the next jump will scan instead
+    setParent(nullptr);
+    deleteLater();
+    return;
+  }
+
+  // The final paragraph separator can't be selected
+  const int end = std::min(position + added, document_->characterCount() - 1);
+  QTextCursor cursor(document_);
+  cursor.setPosition(std::min(position, end));
+  cursor.setPosition(end, QTextCursor::KeepAnchor);
+  const QString inserted = cursor.selectedText();
+
+  characterCount_ += int(inserted.size()) - removed;
+
+  // Some changes are reported inexactly, so start over rather than drift out of step
+  if (characterCount_ != document_->characterCount()) {
+    rebuild();
+    return;
+  }
+
+  enqueue([position, removed, inserted](State& state) {
+    applyEdit(state, position, removed, inserted);
+  });
+}
+
+void DocumentIndex::rebuild() {
+  characterCount_ = document_->characterCount();
+  revision_ = document_->revision();
+
+  enqueue([text = document_->toRawText()](State& state) {
+    const TraceScope trace("indexRebuild");
+
+    state.positions.clear();
+
+    for (int i = 0; i < text.size(); i++) {
+      state.positions[foldCase(text[i].unicode())].push_back(i);
+    }
+  });
+}
+
+void DocumentIndex::enqueue(std::function<void(State&)> job) {
+  state_->pending++;
+
+  worker().start([state = state_, job = std::move(job)] {
+    job(*state);
+
+    qint64 heldBytes = 0;
+
+    for (const auto& [key, list] : state->positions) {
+      heldBytes += qint64(sizeof(list) + list.capacity() * sizeof(int));
+    }
+
+    state->heldBytes = heldBytes;
+    state->pending--;
+  });
+}
+
+void DocumentIndex::applyEdit(
+    State& state,
+    const int position,
+    const int removed,
+    const QString& inserted) {
+  const TraceScope trace("indexEdit");
+
+  const int shift = int(inserted.size()) - removed;
+
+  for (auto& [key, list] : state.positions) {
+    const auto first = std::lower_bound(list.begin(), list.end(), position);
+    const auto last = std::lower_bound(first, list.end(), position + removed);
+
+    for (auto it = last; it != list.end(); ++it) {
+      *it += shift;
+    }
+
+    list.erase(first, last);
+  }
+
+  std::unordered_map<char16_t, std::vector<int>> added;
+
+  for (int i = 0; i < inserted.size(); i++) {
+    added[foldCase(inserted[i].unicode())].push_back(position + i);
+  }
+
+  // Everything after the edit has moved past the inserted text, so each run goes in as a block
+  for (const auto& [key, run] : added) {
+    std::vector<int>& list = state.positions[key];
+    list.insert(std::lower_bound(list.begin(), list.end(), position), run.begin(), run.end());
+  }
+}
+} // namespace Qtmotion
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include <QObject>
+
+#include "TextSource.h"
+
+class QTextDocument;
+
+namespace Qtmotion {
+// Where every character of a document is, by its case-folded form, so jumps can look matches up
+// rather than scanning for them. Lives as a child of its document and follows its edits, with the
+// index itself only touched by a background thread shared by every document.
+class DocumentIndex : public QObject {
+  Q_OBJECT
+
+ public:
+  // The document's index, created if there isn't one yet. Returns null, dropping any index it
+  // had, when indexing the document would take more than budgetBytes.
+  static DocumentIndex* attach(QTextDocument* document, qint64 budgetBytes);
+
+  // False while edits are still being applied in the background, when the index shouldn't be read
+  bool isIdle() const;
+
+  // Ascending positions within the spans of characters that fold to key, see foldedKey()
+  std::vector<int> positions(char16_t key, const std::vector<TextSpan>& spans) const;
+
+ private:
+  DocumentIndex(QTextDocument* document, qint64 budgetBytes);
+
+  void onContentsChange(int position, int removed, int added);
+
+  // Replaces the whole index with one built from the document as it is now
+  void rebuild();
+
+  // What the worker reads and writes, held by its jobs too so the index can go away without
+  // waiting for them
+  struct State {
+    std::atomic<int> pending = 0;
+    // Including the spare capacity of the lists, as of the last job to finish
+    std::atomic<qint64> heldBytes = 0;
+    std::unordered_map<char16_t, std::vector<int>> positions;
+  };
+
+  // Runs on the worker after every job queued before it, for this document or any other
+  void enqueue(std::function<void(State&)> job);
+
+  static void applyEdit(State& state, int position, int removed, const QString& inserted);
+
+  QTextDocument* document_ = nullptr;
+  qint64 budgetBytes_ = 0;
+
+  // What the index will cover once the queued jobs are done, to catch changes it missed
+  int characterCount_ = 0;
+  // The document revision it follows, which formatting and highlighting leave alone
+  int revision_ = 0;
+
+  std::shared_ptr<State> state_ = std::make_shared<State>();
+};
+} // namespace Qtmotion
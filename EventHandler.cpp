@@ -1,73 +1,219 @@
 #include "EventHandler.h"
 
-#include <cstdlib>
+#include <algorithm>
 #include <iostream>
+#include <iterator>
+#include <tuple>
 
+#include <coreplugin/editormanager/documentmodel.h>
 #include <coreplugin/editormanager/editormanager.h>
-#include <coreplugin/progressmanager/futureprogress.h>
-#include <coreplugin/progressmanager/progressmanager.h>
+#include <coreplugin/idocument.h>
+#include <coreplugin/messagemanager.h>
 #include <texteditor/texteditor.h>
-#include <utils/mapreduce.h>
 
-#include <QFutureInterface>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QPainter>
 #include <QPlainTextEdit>
+#include <QScrollBar>
 #include <QTextBlock>
 
+#include "DocumentIndex.h"
+#include "JumpOverlay.h"
+#include "MultiEditSource.h"
+#include "PlainTextEditSource.h"
+#include "Trace.h"
+
 namespace Qtmotion {
 EventHandler::EventHandler() {
-  handlers_.push_back(this);
+  // Matches beyond the screen stream in after the key that started the search
+  connect(&target_, &TargetString::candidatesChanged, this, &EventHandler::updateOverlay);
+
+  // The text they're found in is copied out a batch at a time, after the key has been handled
+  connect(
+      &target_,
+      &TargetString::offscreenTextWanted,
+      this,
+      [this] {
+        if (state_ == State::WaitingForInput) {
+          target_.snapshotOffscreen(source());
+        }
+      },
+      Qt::QueuedConnection);
 }
 
 void EventHandler::triggerBeforeChar() {
-  trigger(true, false);
+  trigger(true, false, true);
 }
 
 void EventHandler::triggerAfterChar() {
-  trigger(false, false);
+  trigger(false, false, true);
 }
 
 void EventHandler::triggerBeforeCharSelect() {
-  trigger(true, true);
+  trigger(true, true, true);
 }
 
 void EventHandler::triggerAfterCharSelect() {
-  trigger(false, true);
+  trigger(false, true, true);
+}
+
+void EventHandler::triggerWordStart() {
+  triggerBoundary(Boundary::WordStart, true);
+}
+
+void EventHandler::triggerLineStart() {
+  triggerBoundary(Boundary::LineStart, true);
+}
+
+void EventHandler::triggerLineEnd() {
+  // Landing after the last character puts the cursor at the end of the line
+  triggerBoundary(Boundary::LineEnd, false);
+}
+
+void EventHandler::triggerCamelHump() {
+  triggerBoundary(Boundary::CamelHump, true);
+}
+
+void EventHandler::triggerPunctuation() {
+  triggerBoundary(Boundary::Punctuation, true);
+}
+
+void EventHandler::triggerBoundary(const Boundary boundary, const bool beforeChar) {
+  trigger(beforeChar, false, false);
+
+  if (state_ == State::WaitingForInput) {
+    target_.jumpToBoundaries(source(), boundary);
+    updateOverlay();
+  }
 }
 
 void EventHandler::updateCommand(const Settings& settings) {
   commandSettings_ = settings;
+
+  switch (settings.keyboardLayout()) {
+    case Settings::KeyboardLayout::Qwerty:
+      labelAlphabet_ = kQwertyAlphabet;
+      break;
+    case Settings::KeyboardLayout::Colemak:
+      labelAlphabet_ = kColemakAlphabet;
+      break;
+    case Settings::KeyboardLayout::Dvorak:
+      labelAlphabet_ = kDvorakAlphabet;
+      break;
+    case Settings::KeyboardLayout::Workman:
+      labelAlphabet_ = kWorkmanAlphabet;
+      break;
+    case Settings::KeyboardLayout::Custom: {
+      // Typed layouts are ordered the same way as the built in ones, just not at compile time
+      std::string keys = settings.customLayout();
+      std::erase_if(keys, [](const char c) { return c == ' ' || c == '\t'; });
+      labelAlphabet_ = LabelAlphabet<kNumLabelKeys>(labelKeyOrder(keys));
+      break;
+    }
+  }
+
+  saveTrigger_.setCommand(
+      settings.runOnSave() ? QString::fromStdString(settings.command()) : QString(),
+      settings.passFilename(),
+      std::chrono::milliseconds(settings.saveDebounceMs()));
+}
+
+void EventHandler::documentSaved(Core::IDocument* document) {
+  if (document && !document->filePath().isEmpty()) {
+    saveTrigger_.fileSaved(document->filePath().toString());
+  }
 }
 
 void EventHandler::triggerCommand() {
+  if (commandSettings_.commandTarget() != Settings::CommandTarget::CurrentFolder) {
+    commandFanOut_.run(
+        QString::fromStdString(commandSettings_.command()),
+        commandFiles(),
+        std::chrono::seconds(commandSettings_.commandTimeoutSeconds()));
+    return;
+  }
+
   const auto editor = Core::EditorManager::currentEditor();
 
+  // Shares the save trigger's runner for the folder, so a save run and this replace each other
   if (editor && commandSettings_.passFilename()) {
-    filePath_ = editor->document()->filePath().absolutePath().toString().toStdString();
-  } else {
-    filePath_ = "";
+    saveTrigger_.runNow(
+        QString::fromStdString(commandSettings_.command()),
+        editor->document()->filePath().absolutePath().toString());
+  } else if (!commandSettings_.passFilename()) {
+    saveTrigger_.runNow(QString::fromStdString(commandSettings_.command()), QString());
   }
+}
+
+QStringList EventHandler::commandFiles() const {
+  QStringList files;
+
+  if (commandSettings_.commandTarget() == Settings::CommandTarget::OpenDocuments) {
+    for (const Core::DocumentModel::Entry* entry : Core::DocumentModel::entries()) {
+      if (!entry->filePath().isEmpty()) {
+        files.push_back(entry->filePath().toString());
+      }
+    }
+  } else {
+    QFile list(QString::fromStdString(commandSettings_.commandFileList()));
 
-  if ((editor && commandSettings_.passFilename()) || !commandSettings_.passFilename()) {
-    Core::ProgressManager::addTask(
-        Utils::map(handlers_, &EventHandler::runCommand), tr("Command"), Utils::Id("Command"));
+    if (!list.open(QIODevice::ReadOnly | QIODevice::Text)) {
+      Core::MessageManager::writeFlashing(tr("Could not read %1").arg(list.fileName()));
+      return files;
+    }
+
+    const QDir folder = QFileInfo(list).absoluteDir();
+
+    while (!list.atEnd()) {
+      const QString line = QString::fromUtf8(list.readLine()).trimmed();
+
+      if (!line.isEmpty()) {
+        files.push_back(folder.absoluteFilePath(line));
+      }
+    }
   }
+
+  return files;
 }
 
-void EventHandler::runCommand(QFutureInterface<void>& future) {
-  future.setProgressRange(0, 100);
+void EventHandler::indexEditor(Core::IEditor* editor) {
+  QPlainTextEdit* textEdit = editor ? qobject_cast<QPlainTextEdit*>(editor->widget()) : nullptr;
 
-  const std::string commandToRun =
-      commandSettings_.command() + (filePath_.length() ? " " + filePath_ : "");
+  if (textEdit) {
+    DocumentIndex::attach(textEdit->document(), indexBudgetBytes());
+  }
+}
 
-  while (!future.isCanceled()) {
-    future.setProgressValue(50);
-    std::system(commandToRun.c_str());
-    break;
+std::optional<TextSpan> EventHandler::searchRange() const {
+  const QTextDocument* document = textEdit_->document();
+
+  switch (commandSettings_.searchScope()) {
+    case Settings::SearchScope::Visible:
+      return std::nullopt;
+    case Settings::SearchScope::Window: {
+      const int lines = commandSettings_.windowLines();
+      const int blockNumber = textEdit_->textCursor().blockNumber();
+      const QTextBlock first = document->findBlockByNumber(std::max(0, blockNumber - lines));
+      const QTextBlock last =
+          document->findBlockByNumber(std::min(document->blockCount() - 1, blockNumber + lines));
+      return TextSpan{.start = first.position(), .end = last.position() + last.length() - 1};
+    }
+    case Settings::SearchScope::Document:
+      return TextSpan{.start = 0, .end = document->characterCount() - 1};
   }
+
+  return std::nullopt;
+}
+
+qint64 EventHandler::indexBudgetBytes() const {
+  return qint64(commandSettings_.indexBudgetMegabytes()) * 1024 * 1024;
 }
 
-void EventHandler::trigger(const bool beforeChar, const bool selection) {
+void EventHandler::trigger(const bool beforeChar, const bool selection, const bool firstKeyTable) {
+  const TraceScope trace("trigger");
+
   if (Core::EditorManager::currentEditor()->widget()->hasFocus()) {
     reset();
 
@@ -78,7 +224,38 @@ void EventHandler::trigger(const bool beforeChar, const bool selection) {
       enqueueEventFilter();
       beforeChar_ = beforeChar;
       selection_ = selection;
-      textEdit_->viewport()->update();
+      target_.setMultiKeyLabels(commandSettings_.multiKeyLabels());
+      target_.setBigramQuery(commandSettings_.bigramQuery());
+      target_.setLabelAlphabet(labelAlphabet_);
+      views_.push_back(View{.textEdit = textEdit_});
+
+      // Every other split showing a text editor joins in after the one with focus
+      if (commandSettings_.allSplits()) {
+        for (Core::IEditor* editor : Core::EditorManager::visibleEditors()) {
+          auto* textEdit = qobject_cast<QPlainTextEdit*>(editor->widget());
+
+          if (textEdit && textEdit != textEdit_ && textEdit->isVisible()) {
+            views_.push_back(View{.textEdit = textEdit});
+          }
+        }
+      }
+
+      for (const View& view : views_) {
+        connect(
+            view.textEdit,
+            &QObject::destroyed,
+            this,
+            &EventHandler::viewDestroyed,
+            Qt::UniqueConnection);
+      }
+
+      // The index and the search range are in the focused document's positions alone
+      const bool split = views_.size() > 1;
+      target_.setIndex(
+          split ? nullptr : DocumentIndex::attach(textEdit_->document(), indexBudgetBytes()));
+      target_.setSearchRange(split ? std::nullopt : searchRange());
+      target_.prepare(source(), firstKeyTable);
+      showOverlay();
     } else {
       currentEditor_ = nullptr;
     }
@@ -86,9 +263,22 @@ void EventHandler::trigger(const bool beforeChar, const bool selection) {
 }
 
 void EventHandler::installEventFilter() {
-  if (textEdit_) {
-    textEdit_->installEventFilter(this);
-    textEdit_->viewport()->installEventFilter(this);
+  for (const View& view : views_) {
+    if (view.textEdit) {
+      view.textEdit->installEventFilter(this);
+      view.textEdit->viewport()->installEventFilter(this);
+    }
+  }
+}
+
+void EventHandler::viewDestroyed(QObject* obj) {
+  // The pointer may or may not have been cleared yet, depending on how far destruction has got
+  const bool gone = std::any_of(views_.begin(), views_.end(), [obj](const View& view) {
+    return view.textEdit.isNull() || view.textEdit.data() == obj;
+  });
+
+  if (gone) {
+    reset();
   }
 }
 
@@ -97,14 +287,107 @@ void EventHandler::enqueueEventFilter() {
   QMetaObject::invokeMethod(this, "installEventFilter", Qt::QueuedConnection);
 }
 
+MultiEditSource EventHandler::source() const {
+  std::vector<QPlainTextEdit*> textEdits;
+
+  for (const View& view : views_) {
+    textEdits.push_back(view.textEdit);
+  }
+
+  return MultiEditSource(textEdits);
+}
+
+void EventHandler::showOverlay() {
+  for (size_t i = 0; i < views_.size(); i++) {
+    QPlainTextEdit* textEdit = views_[i].textEdit;
+    JumpOverlay* overlay =
+        new JumpOverlay(textEdit, [this, i](QPainter& painter, const QRect& dirty) {
+          paintOverlay(i, painter, dirty);
+        });
+    views_[i].overlay = overlay;
+
+    // Labels follow their text when the editor scrolls, which we only hear about from the editor
+    connect(textEdit, &QPlainTextEdit::updateRequest, overlay, [this](const QRect&, const int dy) {
+      if (dy != 0) {
+        updateOverlay();
+      }
+    });
+    connect(textEdit->horizontalScrollBar(), &QScrollBar::valueChanged, overlay, [this] {
+      updateOverlay();
+    });
+  }
+
+  updateOverlay();
+}
+
+void EventHandler::updateOverlay() {
+  if (views_.empty()) {
+    return;
+  }
+
+  const TraceScope trace("layout");
+
+  const MultiEditSource source = this->source();
+
+  auto labelOrder = [](const Label& a, const Label& b) {
+    const auto key = [](const Label& label) {
+      return std::tuple(
+          label.rect.top(),
+          label.rect.left(),
+          label.rect.bottom(),
+          label.rect.right(),
+          label.selectable);
+    };
+    return key(a) != key(b) ? key(a) < key(b) : a.text < b.text;
+  };
+
+  for (size_t i = 0; i < views_.size(); i++) {
+    View& view = views_[i];
+
+    if (view.overlay == nullptr) {
+      continue;
+    }
+
+    // The geometry only changes with the targets, scrolling, resizing or the font, all of which
+    // come through here, so painting can just walk the table
+    std::vector<Label> labels = layoutLabels(i, source);
+    std::sort(labels.begin(), labels.end(), labelOrder);
+
+    // Only what appeared, disappeared or changed needs repainting
+    std::vector<Label> changed;
+    std::set_symmetric_difference(
+        view.labels.begin(),
+        view.labels.end(),
+        labels.begin(),
+        labels.end(),
+        std::back_inserter(changed),
+        labelOrder);
+
+    for (const Label& label : changed) {
+      view.overlay->update(label.rect);
+    }
+
+    view.labels = std::move(labels);
+  }
+}
+
 void EventHandler::reset() {
-  if (setEditor(currentEditor_)) {
-    QWidget* viewport = textEdit_->viewport();
-    textEdit_->removeEventFilter(this);
-    viewport->removeEventFilter(this);
-    textEdit_ = nullptr;
+  for (const View& view : views_) {
+    delete view.overlay.data();
+
+    if (view.textEdit) {
+      view.textEdit->removeEventFilter(this);
+      view.textEdit->viewport()->removeEventFilter(this);
+    }
   }
 
+  views_.clear();
+  textEdit_ = nullptr;
+
+  // A jump is over, so write out what it cost once back in the event loop, where the file I/O
+  // isn't counted against whatever called reset()
+  QMetaObject::invokeMethod(this, &flushTrace, Qt::QueuedConnection);
+
   beforeChar_ = false;
   selection_ = false;
   target_.reset();
@@ -113,19 +396,22 @@ void EventHandler::reset() {
 }
 
 bool EventHandler::eventFilter(QObject* obj, QEvent* event) {
-  QWidget* currentViewport = qobject_cast<QWidget*>(obj);
-  QPlainTextEdit* currentTextEdit = qobject_cast<QPlainTextEdit*>(obj);
-
-  if (currentTextEdit == nullptr && currentViewport != nullptr && event->type() == QEvent::Paint) {
-    // Handle the painter event last to prevent the area painted from being overwritten
-    currentViewport->removeEventFilter(this);
-    QCoreApplication::sendEvent(currentViewport, event);
-    currentViewport->installEventFilter(this);
-
-    QPaintEvent* paintEvent = static_cast<QPaintEvent*>(event);
-    handlePaintEvent(paintEvent);
-
-    return true;
+  const auto view = std::find_if(views_.begin(), views_.end(), [obj](const View& view) {
+    return view.textEdit && (obj == view.textEdit.data() || obj == view.textEdit->viewport());
+  });
+  const bool fromView = view != views_.end();
+
+  if (event->type() == QEvent::Resize && fromView && obj == view->textEdit->viewport()) {
+    if (view->overlay) {
+      view->overlay->syncGeometry();
+      updateOverlay();
+    }
+  } else if (
+      event->type() == QEvent::FontChange && fromView && obj == view->textEdit.data() &&
+      view->overlay) {
+    // The editor relayouts after we see the event, and every label is drawn in its font
+    view->overlay->update();
+    QMetaObject::invokeMethod(this, &EventHandler::updateOverlay, Qt::QueuedConnection);
   } else if (event->type() == QEvent::KeyPress && textEdit_) {
     enqueueEventFilter();
 
@@ -157,23 +443,31 @@ void EventHandler::moveToPosition(QPlainTextEdit* textEdit, int newPos) {
       beforeChar_ ? newPos : newPos + 1,
       selection_ ? QTextCursor::MoveMode::KeepAnchor : QTextCursor::MoveMode::MoveAnchor);
 
+  const std::vector<TextSpan> spans = PlainTextEditSource(textEdit).visibleSpans();
+  const bool offscreen =
+      spans.empty() || newPos < spans.front().start || newPos > spans.back().end;
+
   textEdit->moveCursor(QTextCursor::End);
   textEdit->setTextCursor(textCursor);
+
+  // Land somewhere with context either side rather than on the edge of the screen
+  if (offscreen) {
+    textEdit->centerCursor();
+  }
 }
 
 bool EventHandler::handleKeyPress(QKeyEvent* e) {
+  const TraceScope trace("keyPress");
+
   if (e->key() == Qt::Key_Escape) {
     // Exit the process
-    if (state_ == State::WaitingForInput) {
-      textEdit_->viewport()->update();
-    }
-
     reset();
 
     return true;
   } else if (state_ == State::WaitingForInput && !isModifierKey(e->key())) {
     if (e->key() == Qt::Key_Backspace) {
-      target_.backspace(textEdit_);
+      target_.backspace();
+      updateOverlay();
     } else {
       QChar target(e->key());
       target = target.toLower();
@@ -183,20 +477,29 @@ bool EventHandler::handleKeyPress(QKeyEvent* e) {
       }
 
       int newPos = target_.getPositionForCharSelection(target);
+      const bool selecting = !target_.selection().isEmpty();
 
       if (newPos >= 0) {
-        QPlainTextEdit* textEdit = textEdit_;
-        QWidget* viewport = textEdit_->viewport();
-
-        if (textEdit) {
-          moveToPosition(textEdit, newPos);
+        const MultiEditSource source = this->source();
+        const size_t view = source.viewAt(newPos);
+
+        if (view < views_.size()) {
+          // Focusing the editor also makes it the current one when the target is in another split
+          QPlainTextEdit* textEdit = views_[view].textEdit;
+          textEdit->setFocus();
+          moveToPosition(textEdit, newPos - source.offset(view));
         }
 
         reset();
-
-        viewport->update();
+      } else if (target_.extendSelection(target)) {
+        updateOverlay();
+      } else if (selecting) {
+        // Not part of any label, so give up on the label and let the query be typed again
+        target_.clearSelection();
+        updateOverlay();
       } else if (textEdit_) {
-        target_.appendQuery(textEdit_, target);
+        target_.appendQuery(source(), target);
+        updateOverlay();
       }
     }
 
@@ -205,88 +508,155 @@ bool EventHandler::handleKeyPress(QKeyEvent* e) {
   return false;
 }
 
-void EventHandler::handlePaintEvent(QPaintEvent*) {
-  if (state_ != State::Inactive) {
-    QTextCursor tc = textEdit_->textCursor();
-    QFontMetrics fm(textEdit_->font());
-    QPainter painter(textEdit_->viewport());
+std::vector<EventHandler::Label> EventHandler::layoutLabels(
+    const size_t view,
+    const MultiEditSource& source) const {
+  std::vector<Label> labels;
+
+  QPlainTextEdit* textEdit = views_[view].textEdit;
+  QTextCursor tc = textEdit->textCursor();
+  QFontMetrics fm(textEdit->font());
+  // Labels are drawn from the atlas in bold, a character at a time, so measure them the same way
+  const QFontMetrics labelFm(LabelAtlas::labelFont(textEdit->font()));
+  const auto advance = [&labelFm](const QStringView text) {
+    int width = 0;
+
+    for (const QChar c : text) {
+      width += labelFm.horizontalAdvance(c);
+    }
+
+    return width;
+  };
 
-    textEdit_->viewport()->update();
+  // Targets are in positions across every view, so each view only lays out its own
+  const int offset = source.offset(view);
+  const auto inView = [&source, view](const int position) {
+    return source.viewAt(position) == view;
+  };
 
-    QPen pen;
-    painter.setCompositionMode(QPainter::CompositionMode_SourceIn);
-    QFont font = textEdit_->font();
-    font.setBold(true);
-    painter.setFont(font);
+  // The status box goes on the editor with focus
+  if (view == 0) {
+    QString toDraw = "Qtmotion: ";
 
-    auto drawRectText = [&, this](const QRect& rect, const QString& string) {
-      if (rect.intersects(textEdit_->viewport()->rect())) {
-        painter.setPen(Qt::NoPen);
-        painter.drawRect(rect);
-        painter.setPen(pen);
-        const int textHeight = rect.bottom() - fm.descent();
-        painter.drawText(rect.left(), textHeight, string);
-      }
-    };
+    if (state_ == State::WaitingForInput) {
+      toDraw.append(
+          QString("Query \"") + target_.query() + "\" found in " +
+          QString::fromStdString(std::to_string(
+              target_.selectables().size() + target_.potentialSelectables().size())) +
+          " locations" + (target_.isSearching() ? ", searching" : ""));
+    }
 
-    {
-      QString toDraw = "Qtmotion: ";
+    const QRect textBoundingBox = fm.boundingRect(toDraw);
+    const int textWidth = advance(toDraw);
+    QRect rect;
+    rect.setLeft(textEdit->viewport()->width() - textWidth);
+    rect.setWidth(textWidth);
+    rect.setTop(0);
+    rect.setHeight(textBoundingBox.height());
+
+    labels.push_back(Label{
+        .rect = rect,
+        .text = LabelText(toDraw.cbegin(), toDraw.cend()),
+        .selectable = target_.selectables().size() > 0});
+  }
 
-      if (state_ == State::WaitingForInput) {
-        toDraw.append(
-            QString("Query \"") + target_.query() + "\" found in " +
-            QString::fromStdString(std::to_string(
-                target_.selectables().size() + target_.potentialSelectables().size())) +
-            " locations");
-      }
+  // Searches can reach beyond the screen, where only labels get drawn, pinned to the top or bottom
+  // edge in label order
+  const std::vector<TextSpan> spans = PlainTextEditSource(textEdit).visibleSpans();
+  const int visibleStart = spans.empty() ? 0 : spans.front().start;
+  const int visibleEnd = spans.empty() ? -1 : spans.back().end;
+  int aboveX = 0;
+  int belowX = 0;
 
-      const QRect textBoundingBox = fm.boundingRect(toDraw);
-      const int textWidth = fm.horizontalAdvance(toDraw);
-      QRect rect;
-      rect.setLeft(textEdit_->viewport()->width() - textWidth);
-      rect.setWidth(textWidth);
-      rect.setTop(0);
-      rect.setHeight(textBoundingBox.height());
-
-      if (target_.selectables().size() > 0) {
-        pen.setColor(QColor(170, 170, 255, 255));
-        painter.setBrush(QBrush(QColor(54, 54, 85, 255)));
-      } else {
-        pen.setColor(QColor(255, 170, 170, 255));
-        painter.setBrush(QBrush(QColor(85, 54, 54, 255)));
-      }
-      drawRectText(rect, toDraw);
+  for (size_t i = 0; i < target_.selectables().size(); ++i) {
+    const TargetString::Target target = target_.selectables()[i];
+
+    // Only the labels still reachable from the keys typed so far, minus those keys
+    if (!inView(target.position) || !target.selector.startsWith(target_.selection())) {
+      continue;
+    }
+
+    const QStringView label = target.selector.mid(target_.selection().length());
+    const int position = target.position - offset;
+
+    if (position < visibleStart || position > visibleEnd) {
+      const bool above = position < visibleStart;
+      int& x = above ? aboveX : belowX;
+      const QRect rect(
+          x,
+          above ? 0 : textEdit->viewport()->height() - fm.height(),
+          advance(label),
+          fm.height());
+      x += rect.width() + fm.horizontalAdvance(QLatin1Char(' '));
+
+      labels.push_back(
+          Label{.rect = rect, .text = LabelText(label.begin(), label.end()), .selectable = true});
+      continue;
     }
 
-    for (size_t i = 0; i < target_.selectables().size(); ++i) {
-      const TargetString::Target target = target_.selectables()[i];
-      tc.setPosition(target.position);
+    tc.setPosition(position);
+
+    QRect rect = textEdit->cursorRect(tc);
 
-      QRect rect = textEdit_->cursorRect(tc);
+    const QChar character = target_.characterAt(source, target.position);
 
-      const QChar character = textEdit_->document()->characterAt(target.position);
+    rect.setWidth(std::max(fm.horizontalAdvance(character), advance(label)));
 
-      rect.setWidth(fm.horizontalAdvance(character));
+    labels.push_back(
+        Label{.rect = rect, .text = LabelText(label.begin(), label.end()), .selectable = true});
+  }
+
+  for (size_t i = 0; i < target_.potentialSelectables().size(); ++i) {
+    const TargetString::Target target = target_.potentialSelectables()[i];
+    const int position = target.position - offset;
 
-      pen.setColor(QColor(170, 170, 255, 255));
-      painter.setBrush(QBrush(QColor(54, 54, 85, 255)));
-      drawRectText(rect, target.selector);
+    if (!inView(target.position) || position < visibleStart || position > visibleEnd) {
+      continue;
     }
 
-    for (size_t i = 0; i < target_.potentialSelectables().size(); ++i) {
-      const TargetString::Target target = target_.potentialSelectables()[i];
-      tc.setPosition(target.position);
+    tc.setPosition(position);
 
-      QRect rect = textEdit_->cursorRect(tc);
+    QRect rect = textEdit->cursorRect(tc);
 
-      rect.setWidth(fm.horizontalAdvance(target.selector));
+    const QStringView label = target.selector;
 
-      pen.setColor(QColor(255, 170, 170, 255));
-      painter.setBrush(QBrush(QColor(85, 54, 54, 255)));
-      drawRectText(rect, target.selector);
-    }
+    rect.setWidth(advance(label));
+
+    labels.push_back(
+        Label{.rect = rect, .text = LabelText(label.begin(), label.end()), .selectable = false});
+  }
+
+  return labels;
+}
+
+void EventHandler::paintOverlay(const size_t view, QPainter& painter, const QRect& dirty) {
+  if (state_ == State::Inactive || view >= views_.size() || !views_[view].textEdit) {
+    return;
+  }
+
+  const TraceScope trace("paint");
+
+  atlas_.setFont(views_[view].textEdit->font(), painter.device()->devicePixelRatio());
+
+  for (const Label& label : views_[view].labels) {
+    if (label.rect.intersects(dirty)) {
+      const LabelAtlas::Scheme scheme =
+          label.selectable ? LabelAtlas::Scheme::Selectable : LabelAtlas::Scheme::Potential;
+      int x = label.rect.left();
 
-    painter.end();
+      for (const QChar c : label.text) {
+        const LabelAtlas::Glyph& glyph = atlas_.glyph(c, scheme, label.rect.height());
+        painter.drawPixmap(x, label.rect.top(), glyph.pixmap);
+        x += glyph.width;
+      }
+
+      // Labels are at least as wide as the character they cover
+      if (x <= label.rect.right()) {
+        painter.fillRect(
+            QRect(x, label.rect.top(), label.rect.right() - x + 1, label.rect.height()),
+            LabelAtlas::background(scheme));
+      }
+    }
   }
 }
 
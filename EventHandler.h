@@ -1,22 +1,31 @@
 #pragma once
 
+#include <optional>
+
+#include "CommandFanOut.h"
+#include "LabelAtlas.h"
+#include "MultiEditSource.h"
+#include "SaveTrigger.h"
 #include "Settings.h"
 #include "TargetString.h"
 
 #include <QObject>
+#include <QPointer>
+#include <QRect>
+#include <QVarLengthArray>
 
 class QPlainTextEdit;
 class QKeyEvent;
-class QPaintEvent;
-template <typename T>
-class QFutureInterface;
+class QPainter;
 
 namespace Core {
+class IDocument;
 class IEditor;
-class FutureProgress;
 } // namespace Core
 
 namespace Qtmotion {
+class JumpOverlay;
+
 class EventHandler : public QObject {
   Q_OBJECT
 
@@ -29,15 +38,34 @@ class EventHandler : public QObject {
   void triggerAfterChar();
   void triggerBeforeCharSelect();
   void triggerAfterCharSelect();
+  void triggerWordStart();
+  void triggerLineStart();
+  void triggerLineEnd();
+  void triggerCamelHump();
+  void triggerPunctuation();
   void triggerCommand();
 
+  // Starts keeping an index of the editor's document, if it's within budget
+  void indexEditor(Core::IEditor* editor);
+
+  // Runs the command on the document's folder if the settings ask for that on save
+  void documentSaved(Core::IDocument* document);
+
  private slots:
   void installEventFilter();
 
+  // Ends the jump when one of its editors goes, like a split closing, as the positions of the
+  // views after it no longer line up with the targets
+  void viewDestroyed(QObject* obj);
+
  private:
   void enqueueEventFilter();
 
-  void trigger(const bool beforeChar, const bool selection);
+  // Boundary jumps label their targets straight away, so they have no use for a first key table
+  void trigger(const bool beforeChar, const bool selection, const bool firstKeyTable);
+
+  // Starts a jump with every boundary of a kind already labelled
+  void triggerBoundary(Boundary boundary, bool beforeChar);
 
   void reset();
 
@@ -45,7 +73,25 @@ class EventHandler : public QObject {
 
   bool handleKeyPress(QKeyEvent* e);
 
-  void handlePaintEvent(QPaintEvent*);
+  // Labels are a few keys long, short enough to stay off the heap. Only the status box isn't.
+  using LabelText = QVarLengthArray<QChar, 8>;
+
+  // Everything drawn on the overlay, including the status box in the top right
+  struct Label {
+    QRect rect;
+    LabelText text;
+    bool selectable;
+  };
+
+  // The labels for one view, from targets in the positions of the source over every view
+  std::vector<Label> layoutLabels(size_t view, const MultiEditSource& source) const;
+
+  void showOverlay();
+
+  // Repaints only the labels that differ from what is currently on the overlay
+  void updateOverlay();
+
+  void paintOverlay(size_t view, QPainter& painter, const QRect& dirty);
 
   static bool isModifierKey(int key);
 
@@ -53,7 +99,16 @@ class EventHandler : public QObject {
 
   bool setEditor(Core::IEditor* e);
 
-  void runCommand(QFutureInterface<void>& future);
+  qint64 indexBudgetBytes() const;
+
+  // The files the command runs on when it runs once per file
+  QStringList commandFiles() const;
+
+  // Every view taking part in the jump, laid end to end
+  MultiEditSource source() const;
+
+  // What the search setting covers around the cursor, none when only the screen is searched
+  std::optional<TextSpan> searchRange() const;
 
   enum class State { Inactive, WaitingForInput };
   bool beforeChar_ = false;
@@ -61,10 +116,21 @@ class EventHandler : public QObject {
 
   Core::IEditor* currentEditor_ = nullptr;
   QPlainTextEdit* textEdit_ = nullptr;
+
+  // The editors a jump labels targets in, starting with the one with focus
+  struct View {
+    QPointer<QPlainTextEdit> textEdit;
+    QPointer<JumpOverlay> overlay;
+    std::vector<Label> labels;
+  };
+
+  std::vector<View> views_;
+  LabelAtlas atlas_;
   State state_ = State::Inactive;
   TargetString target_;
-  std::vector<EventHandler*> handlers_;
   Settings commandSettings_;
-  std::string filePath_;
+  LabelAlphabet<kNumLabelKeys> labelAlphabet_ = kQwertyAlphabet;
+  CommandFanOut commandFanOut_;
+  SaveTrigger saveTrigger_;
 };
 } // namespace Qtmotion
@@ -0,0 +1,27 @@
+#include "JumpOverlay.h"
+
+#include <QPaintEvent>
+#include <QPainter>
+#include <QPlainTextEdit>
+
+namespace Qtmotion {
+JumpOverlay::JumpOverlay(QPlainTextEdit* textEdit, PaintCallback paint)
+    : QWidget(textEdit), textEdit_(textEdit), paint_(std::move(paint)) {
+  // A sibling of the viewport rather than a child, so scrolling the viewport doesn't drag us along
+  setAttribute(Qt::WA_TransparentForMouseEvents);
+  setAttribute(Qt::WA_NoSystemBackground);
+  setFocusPolicy(Qt::NoFocus);
+  syncGeometry();
+  raise();
+  show();
+}
+
+void JumpOverlay::syncGeometry() {
+  setGeometry(textEdit_->viewport()->geometry());
+}
+
+void JumpOverlay::paintEvent(QPaintEvent* event) {
+  QPainter painter(this);
+  paint_(painter, event->rect());
+}
+} // namespace Qtmotion
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <functional>
+
+#include <QWidget>
+
+class QPainter;
+class QPlainTextEdit;
+
+namespace Qtmotion {
+// Transparent layer stacked over an editor's viewport that jump labels are drawn on, so showing or
+// changing them never needs the editor itself to repaint
+class JumpOverlay : public QWidget {
+  Q_OBJECT
+
+ public:
+  using PaintCallback = std::function<void(QPainter& painter, const QRect& dirty)>;
+
+  JumpOverlay(QPlainTextEdit* textEdit, PaintCallback paint);
+
+  // Tracks the viewport after it has been resized or moved within the editor
+  void syncGeometry();
+
+ protected:
+  void paintEvent(QPaintEvent* event) override;
+
+ private:
+  QPlainTextEdit* textEdit_ = nullptr;
+  PaintCallback paint_;
+};
+} // namespace Qtmotion
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <utility>
+
+#include "LabelAllocator.h"
+
+namespace Qtmotion {
+// Labels use both cases of every letter
+constexpr size_t kNumLabelKeys = 52;
+
+// Where a layout puts its keys, as the top, home and bottom rows of ten read left to right
+constexpr std::string_view kQwertyKeys = "qwertyuiopasdfghjkl;zxcvbnm,./";
+constexpr std::string_view kColemakKeys = "qwfpgjluy;arstdhneiozxcvbkm,./";
+constexpr std::string_view kDvorakKeys = "',.pyfgcrlaoeuidhtns;qjkxbmwvz";
+constexpr std::string_view kWorkmanKeys = "qdrwbjfup;ashtgyneoizxmcvkl,./";
+
+// The finger that types each column of the layouts' rows and the column it rests on, from the
+// left little finger across to the right one. Index fingers also cover the two middle columns.
+struct Finger {
+  int homeColumn;
+  // How much harder it is to use than an index finger, 0 to 3 out to the little finger
+  int weakness;
+  bool leftHand;
+};
+
+constexpr std::array<Finger, 10> kColumnFingers = {{
+    {.homeColumn = 0, .weakness = 3, .leftHand = true},
+    {.homeColumn = 1, .weakness = 2, .leftHand = true},
+    {.homeColumn = 2, .weakness = 1, .leftHand = true},
+    {.homeColumn = 3, .weakness = 0, .leftHand = true},
+    {.homeColumn = 3, .weakness = 0, .leftHand = true},
+    {.homeColumn = 6, .weakness = 0, .leftHand = false},
+    {.homeColumn = 6, .weakness = 0, .leftHand = false},
+    {.homeColumn = 7, .weakness = 1, .leftHand = false},
+    {.homeColumn = 8, .weakness = 2, .leftHand = false},
+    {.homeColumn = 9, .weakness = 3, .leftHand = false},
+}};
+
+// How far the top, home and bottom rows sit to the right of the home row, in quarter keys, as on a
+// row staggered keyboard
+constexpr std::array<int, 3> kRowStagger = {-1, 0, 2};
+
+// How hard the key at row and column is to reach from the fingers resting on the home row, lowest
+// first. Mirror image keys go to the right hand first.
+constexpr int keyCost(const int row, const int column) {
+  const Finger& finger = kColumnFingers[column];
+
+  // Sideways from the finger's home key in quarter keys, positive towards the other hand
+  const int offset = 4 * (column - finger.homeColumn) + kRowStagger[row];
+  const int inward = finger.leftHand ? offset : -offset;
+  const int sideways = inward * inward;
+
+  int reach = sideways;
+
+  if (row == 0) {
+    // Stretching up and to the side is harder than curling down
+    reach = 15 + 2 * sideways;
+  } else if (row == 2) {
+    // Curling down and away from the other hand is awkward
+    reach = 14 + (inward < 0 ? 6 : 1) * sideways;
+  }
+
+  // Index fingers move off the home row for half what the others do
+  const int effort = 3 * finger.weakness + (finger.weakness == 0 ? 1 : 2) * reach;
+  return 2 * effort + (finger.leftHand ? 1 : 0);
+}
+
+// Label keys ordered by the cost of the key each letter sits on in the layout, all lowercase
+// letters before any uppercase. Letters the layout leaves out go last, in alphabetical order.
+constexpr std::array<char, kNumLabelKeys> labelKeyOrder(const std::string_view keys) {
+  constexpr int kUnplaced = 1000;
+  std::array<int, 26> costs{};
+  costs.fill(kUnplaced);
+
+  for (size_t i = 0; i < keys.size() && i < 30; i++) {
+    const char c = keys[i] >= 'A' && keys[i] <= 'Z' ? char(keys[i] - 'A' + 'a') : keys[i];
+
+    if (c >= 'a' && c <= 'z' && costs[c - 'a'] == kUnplaced) {
+      costs[c - 'a'] = keyCost(int(i / 10), int(i % 10));
+    }
+  }
+
+  std::array<char, 26> letters{};
+
+  for (size_t i = 0; i < letters.size(); i++) {
+    letters[i] = char('a' + i);
+  }
+
+  // Few enough letters that a stable insertion sort is fine, and it keeps ties alphabetical
+  for (size_t i = 1; i < letters.size(); i++) {
+    for (size_t j = i; j > 0 && costs[letters[j] - 'a'] < costs[letters[j - 1] - 'a']; j--) {
+      std::swap(letters[j], letters[j - 1]);
+    }
+  }
+
+  std::array<char, kNumLabelKeys> order{};
+
+  for (size_t i = 0; i < letters.size(); i++) {
+    order[i] = letters[i];
+    order[i + letters.size()] = char(letters[i] - 'a' + 'A');
+  }
+
+  return order;
+}
+
+constexpr LabelAlphabet<kNumLabelKeys> kQwertyAlphabet{labelKeyOrder(kQwertyKeys)};
+constexpr LabelAlphabet<kNumLabelKeys> kColemakAlphabet{labelKeyOrder(kColemakKeys)};
+constexpr LabelAlphabet<kNumLabelKeys> kDvorakAlphabet{labelKeyOrder(kDvorakKeys)};
+constexpr LabelAlphabet<kNumLabelKeys> kWorkmanAlphabet{labelKeyOrder(kWorkmanKeys)};
+
+// The order labels have always been handed out in, which the costs above have to reproduce
+static_assert(
+    labelKeyOrder(kQwertyKeys) ==
+    std::array<char, kNumLabelKeys>{
+        'j', 'f', 'k', 'd', 'l', 's', 'a', 'h', 'g', 'u', 'r', 'n', 'v', 't', 'i', 'e', 'm', 'c',
+        'o', 'w', 'x', 'p', 'q', 'z', 'b', 'y', 'J', 'F', 'K', 'D', 'L', 'S', 'A', 'H', 'G', 'U',
+        'R', 'N', 'V', 'T', 'I', 'E', 'M', 'C', 'O', 'W', 'X', 'P', 'Q', 'Z', 'B', 'Y'});
+} // namespace Qtmotion
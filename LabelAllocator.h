@@ -0,0 +1,102 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+
+#include <QChar>
+
+namespace Qtmotion {
+// A fixed order of label keys, with a lookup from ASCII character to its slot in that order
+template <size_t N>
+class LabelAlphabet {
+ public:
+  static constexpr size_t kWords = (N + 63) / 64;
+
+  constexpr explicit LabelAlphabet(const std::array<char, N>& keys) : keys_(keys) {
+    slots_.fill(-1);
+
+    for (size_t i = 0; i < N; i++) {
+      slots_[static_cast<unsigned char>(keys[i]) & 0x7F] = static_cast<int16_t>(i);
+    }
+  }
+
+  constexpr char key(const size_t slot) const {
+    return keys_[slot];
+  }
+
+  constexpr int slot(const char16_t c) const {
+    return c < slots_.size() ? slots_[c] : -1;
+  }
+
+ private:
+  std::array<char, N> keys_;
+  std::array<int16_t, 128> slots_{};
+};
+
+// Tracks which labels of an alphabet are still free with one bit per key, so excluding the
+// characters that continue each match and handing out labels in key order are both bit operations
+template <size_t N>
+class LabelAllocator {
+ public:
+  explicit LabelAllocator(const LabelAlphabet<N>& alphabet) : alphabet_(alphabet) {}
+
+  // Forbids both cases of a character that could be typed to extend the query
+  void forbid(const QChar& c) {
+    const char16_t u = c.unicode();
+
+    if (u < 0x80) {
+      forbidSlot(alphabet_.slot(u));
+
+      if ((u | 0x20) >= 'a' && (u | 0x20) <= 'z') {
+        forbidSlot(alphabet_.slot(u ^ 0x20));
+      }
+    } else {
+      // Non-ASCII characters can still fold onto an ASCII key
+      forbidSlot(alphabet_.slot(c.toUpper().unicode()));
+      forbidSlot(alphabet_.slot(c.toLower().unicode()));
+    }
+  }
+
+  size_t freeCount() const {
+    size_t count = 0;
+
+    for (size_t w = 0; w < kWords; w++) {
+      count += std::popcount(freeBits(w));
+    }
+
+    return count;
+  }
+
+  // Calls fn(index, key) for the first count free keys in alphabet order
+  template <typename Fn>
+  void assign(const size_t count, Fn&& fn) const {
+    size_t index = 0;
+
+    for (size_t w = 0; w < kWords && index < count; w++) {
+      for (uint64_t bits = freeBits(w); bits && index < count; bits &= bits - 1) {
+        fn(index++, alphabet_.key(w * 64 + std::countr_zero(bits)));
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kWords = LabelAlphabet<N>::kWords;
+
+  void forbidSlot(const int slot) {
+    if (slot >= 0) {
+      forbidden_[slot / 64] |= uint64_t(1) << (slot % 64);
+    }
+  }
+
+  uint64_t freeBits(const size_t word) const {
+    const size_t used = N - word * 64;
+    const uint64_t valid = used >= 64 ? ~uint64_t(0) : (uint64_t(1) << used) - 1;
+    return ~forbidden_[word] & valid;
+  }
+
+  const LabelAlphabet<N>& alphabet_;
+  std::array<uint64_t, kWords> forbidden_{};
+};
+} // namespace Qtmotion
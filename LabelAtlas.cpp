@@ -0,0 +1,57 @@
+#include "LabelAtlas.h"
+
+#include <QFontMetrics>
+#include <QPainter>
+
+namespace Qtmotion {
+QColor LabelAtlas::background(const Scheme scheme) {
+  return scheme == Scheme::Selectable ? QColor(54, 54, 85, 255) : QColor(85, 54, 54, 255);
+}
+
+QColor LabelAtlas::foreground(const Scheme scheme) {
+  return scheme == Scheme::Selectable ? QColor(170, 170, 255, 255) : QColor(255, 170, 170, 255);
+}
+
+QFont LabelAtlas::labelFont(const QFont& font) {
+  QFont bold = font;
+  bold.setBold(true);
+  return bold;
+}
+
+void LabelAtlas::setFont(const QFont& font, const qreal devicePixelRatio) {
+  const QFont bold = labelFont(font);
+  auto [it, inserted] = pages_.try_emplace(std::pair(bold.key(), devicePixelRatio));
+
+  if (inserted) {
+    it->second.font = bold;
+    it->second.devicePixelRatio = devicePixelRatio;
+  }
+
+  page_ = &it->second;
+}
+
+const LabelAtlas::Glyph& LabelAtlas::glyph(const QChar& c, const Scheme scheme, const int height) {
+  const quint64 key = (quint64(height) << 24) | (quint64(scheme) << 16) | c.unicode();
+
+  auto it = page_->glyphs.find(key);
+
+  if (it != page_->glyphs.end()) {
+    return it->second;
+  }
+
+  const QFontMetrics fm(page_->font);
+  const int width = fm.horizontalAdvance(c);
+
+  QPixmap pixmap(QSize(width, height) * page_->devicePixelRatio);
+  pixmap.setDevicePixelRatio(page_->devicePixelRatio);
+  pixmap.fill(background(scheme));
+
+  QPainter painter(&pixmap);
+  painter.setFont(page_->font);
+  painter.setPen(foreground(scheme));
+  painter.drawText(0, height - 1 - fm.descent(), QString(c));
+  painter.end();
+
+  return page_->glyphs.emplace(key, Glyph{.pixmap = pixmap, .width = width}).first->second;
+}
+} // namespace Qtmotion
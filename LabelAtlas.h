@@ -0,0 +1,46 @@
+#pragma once
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+#include <QColor>
+#include <QFont>
+#include <QPixmap>
+
+namespace Qtmotion {
+// Label characters pre-rendered onto their backgrounds, so painting the overlay is a run of pixmap
+// blits instead of shaping text every frame. Glyphs are built the first time they're asked for and
+// kept per font and device pixel ratio for later jumps.
+class LabelAtlas {
+ public:
+  enum class Scheme { Selectable, Potential };
+
+  struct Glyph {
+    QPixmap pixmap;
+    int width;
+  };
+
+  static QColor background(Scheme scheme);
+  static QColor foreground(Scheme scheme);
+
+  // The font glyphs are drawn in, so labels can be laid out to the widths the atlas renders
+  static QFont labelFont(const QFont& font);
+
+  // Selects the glyphs drawn with this (unbolded) editor font at this device pixel ratio
+  void setFont(const QFont& font, qreal devicePixelRatio);
+
+  // Only valid until the next call, which may add to the atlas
+  const Glyph& glyph(const QChar& c, Scheme scheme, int height);
+
+ private:
+  struct Page {
+    QFont font;
+    qreal devicePixelRatio;
+    std::unordered_map<quint64, Glyph> glyphs;
+  };
+
+  std::map<std::pair<QString, qreal>, Page> pages_;
+  Page* page_ = nullptr;
+};
+} // namespace Qtmotion
@@ -0,0 +1,75 @@
+#include "MappedFileSource.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace Qtmotion {
+MappedFileSource::MappedFileSource(const QString& path) : file_(path) {
+  const qint64 size = file_.size();
+
+  if (size < qint64(sizeof(char16_t)) ||
+      size / qint64(sizeof(char16_t)) > std::numeric_limits<int>::max() ||
+      !file_.open(QIODevice::ReadOnly)) {
+    return;
+  }
+
+  const uchar* map = file_.map(0, size);
+
+  if (map == nullptr) {
+    return;
+  }
+
+  // Mappings are page aligned, so this is suitably aligned for char16_t
+  data_ = reinterpret_cast<const char16_t*>(map);
+  length_ = int(size / qint64(sizeof(char16_t)));
+
+  if (data_[0] == u'\xFEFF') {
+    data_++;
+    length_--;
+  }
+
+  visible_ = TextSpan{.start = 0, .end = length_ - 1};
+}
+
+bool MappedFileSource::isOpen() const {
+  return data_ != nullptr;
+}
+
+int MappedFileSource::length() const {
+  return length_;
+}
+
+void MappedFileSource::setVisibleRange(const int start, const int end) {
+  visible_ = TextSpan{.start = std::max(start, 0), .end = std::min(end, length_ - 1)};
+}
+
+void MappedFileSource::setCursorPosition(const int position) {
+  cursorPosition_ = position;
+}
+
+std::vector<TextSpan> MappedFileSource::visibleSpans() const {
+  if (visible_.start > visible_.end) {
+    return {};
+  }
+
+  return {visible_};
+}
+
+int MappedFileSource::cursorPosition() const {
+  return cursorPosition_;
+}
+
+int MappedFileSource::revision() const {
+  // The mapping is read only
+  return 0;
+}
+
+QChar MappedFileSource::characterAt(const int position) const {
+  return position >= 0 && position < length_ ? QChar(data_[position]) : QChar();
+}
+
+QStringView MappedFileSource::characters(const int position, const int length, QString&) const {
+  const int first = std::clamp(position, 0, length_);
+  return QStringView(data_ + first, std::clamp(length, 0, length_ - first));
+}
+} // namespace Qtmotion
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QFile>
+
+#include "TextSource.h"
+
+namespace Qtmotion {
+// Serves a UTF-16 (little-endian, optionally with a byte order mark) file straight out of a memory
+// mapping, so the engine can be driven over fixtures far larger than an editor would hold without
+// copying them. Line breaks are left as they are in the file, and positions are limited to int
+// like QTextDocument's. There is no viewport, so the caller sets the visible range and cursor.
+class MappedFileSource : public TextSource {
+ public:
+  explicit MappedFileSource(const QString& path);
+
+  bool isOpen() const;
+  int length() const;
+
+  void setVisibleRange(int start, int end);
+  void setCursorPosition(int position);
+
+  std::vector<TextSpan> visibleSpans() const override;
+  int cursorPosition() const override;
+  int revision() const override;
+  QChar characterAt(int position) const override;
+  QStringView characters(int position, int length, QString& scratch) const override;
+
+ private:
+  QFile file_;
+  const char16_t* data_ = nullptr;
+  int length_ = 0;
+  TextSpan visible_{.start = 0, .end = -1};
+  int cursorPosition_ = 0;
+};
+} // namespace Qtmotion
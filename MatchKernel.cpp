@@ -0,0 +1,323 @@
+#include "MatchKernel.h"
+
+#include <array>
+#include <bit>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define QTMOTION_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+namespace Qtmotion {
+namespace {
+struct Needle {
+  char16_t query;
+  // ASCII counterpart that also matches when folding case, equal to query otherwise
+  char16_t alternate;
+  bool caseInsensitive;
+};
+
+Needle makeNeedle(const QChar& query) {
+  const char16_t q = query.unicode();
+  const bool caseInsensitive = !matchesExactCase(query);
+  const bool asciiLower = q >= u'a' && q <= u'z';
+  return Needle{
+      .query = q,
+      .alternate = caseInsensitive && asciiLower ? char16_t(q - u'a' + u'A') : q,
+      .caseInsensitive = caseInsensitive};
+}
+
+void findScalar(
+    const char16_t* data,
+    const int length,
+    const Needle& needle,
+    const int basePosition,
+    std::vector<int>& positions) {
+  for (int i = 0; i < length; i++) {
+    QChar c(data[i]);
+
+    if (needle.caseInsensitive) {
+      c = c.toLower();
+    }
+
+    if (c.unicode() == needle.query) {
+      positions.push_back(basePosition + i);
+    }
+  }
+}
+
+#ifdef QTMOTION_X86_64
+// Each 16-bit lane sets two adjacent bits in a byte movemask
+void appendLaneHits(uint32_t mask, const int basePosition, std::vector<int>& positions) {
+  while (mask) {
+    positions.push_back(basePosition + std::countr_zero(mask) / 2);
+    mask &= mask - 1;
+    mask &= mask - 1;
+  }
+}
+
+void findSse2(
+    const char16_t* data,
+    const int length,
+    const Needle& needle,
+    const int basePosition,
+    std::vector<int>& positions) {
+  const __m128i query = _mm_set1_epi16(short(needle.query));
+  const __m128i alternate = _mm_set1_epi16(short(needle.alternate));
+  const __m128i nonAsciiBits = _mm_set1_epi16(short(0xFF80));
+  const __m128i zero = _mm_setzero_si128();
+
+  int i = 0;
+
+  for (; i + 8 <= length; i += 8) {
+    const __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+
+    // Non-ASCII characters can fold onto ASCII queries (e.g. KELVIN SIGN), so let the scalar
+    // path decide those blocks
+    if (needle.caseInsensitive &&
+        _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(chars, nonAsciiBits), zero)) != 0xFFFF) {
+      findScalar(data + i, 8, needle, basePosition + i, positions);
+      continue;
+    }
+
+    const __m128i equal =
+        _mm_or_si128(_mm_cmpeq_epi16(chars, query), _mm_cmpeq_epi16(chars, alternate));
+    appendLaneHits(uint32_t(_mm_movemask_epi8(equal)), basePosition + i, positions);
+  }
+
+  findScalar(data + i, length - i, needle, basePosition + i, positions);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((target("avx2")))
+#endif
+void findAvx2(
+    const char16_t* data,
+    const int length,
+    const Needle& needle,
+    const int basePosition,
+    std::vector<int>& positions) {
+  const __m256i query = _mm256_set1_epi16(short(needle.query));
+  const __m256i alternate = _mm256_set1_epi16(short(needle.alternate));
+  const __m256i nonAsciiBits = _mm256_set1_epi16(short(0xFF80));
+  const __m256i zero = _mm256_setzero_si256();
+
+  int i = 0;
+
+  for (; i + 16 <= length; i += 16) {
+    const __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+
+    if (needle.caseInsensitive &&
+        uint32_t(_mm256_movemask_epi8(
+            _mm256_cmpeq_epi16(_mm256_and_si256(chars, nonAsciiBits), zero))) != 0xFFFFFFFFu) {
+      findScalar(data + i, 16, needle, basePosition + i, positions);
+      continue;
+    }
+
+    const __m256i equal =
+        _mm256_or_si256(_mm256_cmpeq_epi16(chars, query), _mm256_cmpeq_epi16(chars, alternate));
+    appendLaneHits(uint32_t(_mm256_movemask_epi8(equal)), basePosition + i, positions);
+  }
+
+  findSse2(data + i, length - i, needle, basePosition + i, positions);
+}
+
+bool cpuSupportsAvx2() {
+#if defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 0);
+
+  if (info[0] < 7) {
+    return false;
+  }
+
+  // The OS has to save the YMM registers too, not just the CPU support them
+  __cpuid(info, 1);
+  constexpr int kOsxsave = 1 << 27;
+  constexpr int kAvx = 1 << 28;
+
+  if ((info[2] & kOsxsave) == 0 || (info[2] & kAvx) == 0 || (_xgetbv(0) & 6) != 6) {
+    return false;
+  }
+
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+using Kernel = void (*)(const char16_t*, int, const Needle&, int, std::vector<int>&);
+
+Kernel selectKernel() {
+#ifdef QTMOTION_X86_64
+  return cpuSupportsAvx2() ? findAvx2 : findSse2;
+#else
+  return findScalar;
+#endif
+}
+
+// What a character counts as when looking for boundaries. Line breaks include the ends of the
+// document.
+enum class CharClass : uint8_t {
+  Space,
+  Break,
+  Lower,
+  Upper,
+  Digit,
+  Underscore,
+  Punctuation,
+  Count,
+};
+
+constexpr size_t kNumClasses = size_t(CharClass::Count);
+
+constexpr CharClass asciiClass(const char16_t c) {
+  if (c == 0 || c == u'\n' || c == u'\r') {
+    return CharClass::Break;
+  } else if (c <= u' ' || c == 0x7F) {
+    return CharClass::Space;
+  } else if (c >= u'a' && c <= u'z') {
+    return CharClass::Lower;
+  } else if (c >= u'A' && c <= u'Z') {
+    return CharClass::Upper;
+  } else if (c >= u'0' && c <= u'9') {
+    return CharClass::Digit;
+  } else if (c == u'_') {
+    return CharClass::Underscore;
+  }
+
+  return CharClass::Punctuation;
+}
+
+constexpr auto kAsciiClasses = [] {
+  std::array<CharClass, 128> classes{};
+
+  for (char16_t c = 0; c < classes.size(); c++) {
+    classes[c] = asciiClass(c);
+  }
+
+  return classes;
+}();
+
+CharClass classify(const char16_t c) {
+  if (c < 0x80) {
+    return kAsciiClasses[c];
+  }
+
+  const QChar q(c);
+
+  if (c == QChar::ParagraphSeparator || c == QChar::LineSeparator) {
+    return CharClass::Break;
+  } else if (q.isSpace()) {
+    return CharClass::Space;
+  } else if (q.isUpper()) {
+    return CharClass::Upper;
+  } else if (q.isLetter()) {
+    // Scripts without case only ever start words
+    return CharClass::Lower;
+  } else if (q.isNumber()) {
+    return CharClass::Digit;
+  }
+
+  return CharClass::Punctuation;
+}
+
+constexpr uint8_t boundariesOf(const CharClass p, const CharClass c, const CharClass n) {
+  const auto word = [](const CharClass x) {
+    return x == CharClass::Lower || x == CharClass::Upper || x == CharClass::Digit ||
+        x == CharClass::Underscore;
+  };
+
+  const bool wordStart = word(c) && !word(p);
+  // Lower to upper as in camelCase, or the last of a run of capitals as in HTTPServer
+  const bool hump = c == CharClass::Upper &&
+      (p == CharClass::Lower || p == CharClass::Digit ||
+       (p == CharClass::Upper && n == CharClass::Lower));
+  const bool snake = p == CharClass::Underscore && word(c) && c != CharClass::Underscore;
+
+  uint8_t boundaries = 0;
+
+  if (wordStart) {
+    boundaries |= uint8_t(Boundary::WordStart);
+  }
+
+  if (c != CharClass::Break && p == CharClass::Break) {
+    boundaries |= uint8_t(Boundary::LineStart);
+  }
+
+  if (c != CharClass::Break && n == CharClass::Break) {
+    boundaries |= uint8_t(Boundary::LineEnd);
+  }
+
+  if (wordStart || hump || snake) {
+    boundaries |= uint8_t(Boundary::CamelHump);
+  }
+
+  if (c == CharClass::Punctuation && p != CharClass::Punctuation) {
+    boundaries |= uint8_t(Boundary::Punctuation);
+  }
+
+  return boundaries;
+}
+
+// Indexed by the classes of the previous, current and next characters
+constexpr auto kBoundaries = [] {
+  std::array<uint8_t, kNumClasses * kNumClasses * kNumClasses> boundaries{};
+
+  for (size_t p = 0; p < kNumClasses; p++) {
+    for (size_t c = 0; c < kNumClasses; c++) {
+      for (size_t n = 0; n < kNumClasses; n++) {
+        boundaries[(p * kNumClasses + c) * kNumClasses + n] =
+            boundariesOf(CharClass(p), CharClass(c), CharClass(n));
+      }
+    }
+  }
+
+  return boundaries;
+}();
+} // namespace
+
+void findCharOccurrences(
+    const char16_t* data,
+    const int length,
+    const QChar& query,
+    const int basePosition,
+    std::vector<int>& positions) {
+  static const Kernel kernel = selectKernel();
+  kernel(data, length, makeNeedle(query), basePosition, positions);
+}
+
+void findBoundaries(
+    const char16_t* data,
+    const int length,
+    const QChar& previous,
+    const QChar& next,
+    const Boundary boundary,
+    const int basePosition,
+    std::vector<int>& positions) {
+  if (length <= 0) {
+    return;
+  }
+
+  const uint8_t wanted = uint8_t(boundary);
+  size_t p = size_t(classify(previous.unicode()));
+  size_t c = size_t(classify(data[0]));
+
+  for (int i = 0; i < length; i++) {
+    const size_t n = size_t(classify(i + 1 < length ? data[i + 1] : next.unicode()));
+
+    if (kBoundaries[(p * kNumClasses + c) * kNumClasses + n] & wanted) {
+      positions.push_back(basePosition + i);
+    }
+
+    p = c;
+    c = n;
+  }
+}
+} // namespace Qtmotion
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <QChar>
+
+namespace Qtmotion {
+// Uppercase letters only match themselves, anything else matches whatever lowercases to it
+inline bool matchesExactCase(const QChar& query) {
+  return query.category() == QChar::Letter_Uppercase;
+}
+
+// The form a case-insensitive query compares characters in
+inline char16_t foldCase(const char16_t c) {
+  if (c < 0x80) {
+    return c >= u'A' && c <= u'Z' ? char16_t(c - u'A' + u'a') : c;
+  }
+
+  return QChar(c).toLower().unicode();
+}
+
+// What an index of folded characters holds the candidates for query under
+inline char16_t foldedKey(const QChar& query) {
+  return matchesExactCase(query) ? foldCase(query.unicode()) : query.unicode();
+}
+
+// Appends basePosition + i for every i in [0, length) where data[i] matches query. As with typed
+// jump queries, anything other than an uppercase letter matches case-insensitively. Dispatches at
+// runtime to an AVX2 or SSE2 kernel where available, falling back to a scalar loop otherwise.
+void findCharOccurrences(
+    const char16_t* data,
+    int length,
+    const QChar& query,
+    int basePosition,
+    std::vector<int>& positions);
+
+// Places a jump can target without typing anything
+enum class Boundary : uint8_t {
+  // The first letter, digit or underscore of a word
+  WordStart = 1 << 0,
+  // The first and last character of each line
+  LineStart = 1 << 1,
+  LineEnd = 1 << 2,
+  // Word starts plus where camelCase, PascalCase and snake_case words continue
+  CamelHump = 1 << 3,
+  // The first of each run of punctuation
+  Punctuation = 1 << 4,
+};
+
+// Appends basePosition + i for every i in [0, length) that starts or ends the given kind of
+// boundary. previous and next are the characters either side of the data, null at the ends of the
+// document. Every kind is worked out at once from a table of each character's neighbours.
+void findBoundaries(
+    const char16_t* data,
+    int length,
+    const QChar& previous,
+    const QChar& next,
+    Boundary boundary,
+    int basePosition,
+    std::vector<int>& positions);
+} // namespace Qtmotion
@@ -0,0 +1,98 @@
+#include "MultiEditSource.h"
+
+#include <algorithm>
+
+#include <QPlainTextEdit>
+#include <QTextDocument>
+
+namespace Qtmotion {
+MultiEditSource::MultiEditSource(const std::vector<QPlainTextEdit*>& textEdits) {
+  int offset = 0;
+
+  // Each document ends in a paragraph separator, which keeps them apart
+  for (QPlainTextEdit* textEdit : textEdits) {
+    const int length = textEdit->document()->characterCount();
+    views_.push_back(
+        View{.source = PlainTextEditSource(textEdit), .offset = offset, .length = length});
+    offset += length;
+  }
+}
+
+size_t MultiEditSource::viewAt(const int position) const {
+  const auto after = std::upper_bound(
+      views_.begin(), views_.end(), position, [](const int pos, const View& view) {
+        return pos < view.offset;
+      });
+
+  return after == views_.begin() ? 0 : size_t(after - views_.begin()) - 1;
+}
+
+int MultiEditSource::offset(const size_t view) const {
+  return views_[view].offset;
+}
+
+std::vector<TextSpan> MultiEditSource::visibleSpans() const {
+  std::vector<TextSpan> spans;
+
+  for (const View& view : views_) {
+    for (const TextSpan& span : view.source.visibleSpans()) {
+      spans.push_back(
+          TextSpan{.start = view.offset + span.start, .end = view.offset + span.end});
+    }
+  }
+
+  return spans;
+}
+
+int MultiEditSource::cursorPosition() const {
+  return views_.empty() ? 0 : views_.front().source.cursorPosition();
+}
+
+int MultiEditSource::revision() const {
+  int revision = 0;
+
+  for (const View& view : views_) {
+    revision += view.source.revision();
+  }
+
+  return revision;
+}
+
+QChar MultiEditSource::characterAt(const int position) const {
+  if (views_.empty()) {
+    return QChar();
+  }
+
+  const View& view = views_[viewAt(position)];
+  const int local = position - view.offset;
+  return local >= 0 && local < view.length ? view.source.characterAt(local) : QChar();
+}
+
+QStringView MultiEditSource::characters(
+    const int position,
+    const int length,
+    QString& scratch) const {
+  if (views_.empty()) {
+    return {};
+  }
+
+  const size_t first = viewAt(position);
+  const View& view = views_[first];
+
+  if (position + length <= view.offset + view.length) {
+    return view.source.characters(position - view.offset, length, scratch);
+  }
+
+  // Crosses from one document into the next, so piece the parts together
+  QString part;
+  scratch.clear();
+
+  for (size_t i = first; i < views_.size() && views_[i].offset < position + length; i++) {
+    const int start = std::max(position, views_[i].offset);
+    const int end = std::min(position + length, views_[i].offset + views_[i].length);
+    scratch.append(views_[i].source.characters(start - views_[i].offset, end - start, part));
+  }
+
+  return scratch;
+}
+} // namespace Qtmotion
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "PlainTextEditSource.h"
+
+namespace Qtmotion {
+// Several editors' documents laid end to end in one run of positions, so a single jump can label
+// targets across all of them. Jumps start from the first editor's cursor.
+class MultiEditSource : public TextSource {
+ public:
+  explicit MultiEditSource(const std::vector<QPlainTextEdit*>& textEdits);
+
+  // Which editor holds position, and where its document starts
+  size_t viewAt(int position) const;
+  int offset(size_t view) const;
+
+  std::vector<TextSpan> visibleSpans() const override;
+  int cursorPosition() const override;
+  int revision() const override;
+  QChar characterAt(int position) const override;
+  QStringView characters(int position, int length, QString& scratch) const override;
+
+ private:
+  struct View {
+    PlainTextEditSource source;
+    int offset;
+    int length;
+  };
+
+  std::vector<View> views_;
+};
+} // namespace Qtmotion
@@ -3,10 +3,12 @@
 #include "Settings.h"
 
 #include <QCheckBox>
+#include <QComboBox>
 #include <QHBoxLayout>
 #include <QLabel>
 #include <QLineEdit>
 #include <QSpacerItem>
+#include <QSpinBox>
 #include <QVBoxLayout>
 
 namespace Qtmotion {
@@ -27,6 +29,128 @@ OptPageMainWidget::OptPageMainWidget(const Settings* settings) {
   passFilename_->setChecked(settings->passFilename());
   checkBoxRow->addWidget(passFilename_);
 
+  QHBoxLayout* targetRow = new QHBoxLayout;
+  layout->addLayout(targetRow);
+  targetRow->addWidget(new QLabel("Run it on:"));
+  commandTarget_ = new QComboBox;
+  commandTarget_->addItem("The current file's folder");
+  commandTarget_->addItem("Every open document, in parallel");
+  commandTarget_->addItem("Every file in a list, in parallel");
+  commandTarget_->setCurrentIndex(int(settings->commandTarget()));
+  targetRow->addWidget(commandTarget_);
+  commandFileList_ = new QLineEdit(QString::fromStdString(settings->commandFileList()));
+  commandFileList_->setPlaceholderText("File listing one path per line");
+  targetRow->addWidget(commandFileList_);
+
+  QHBoxLayout* timeoutRow = new QHBoxLayout;
+  layout->addLayout(timeoutRow);
+  timeoutRow->addWidget(new QLabel("Stop each parallel run after:"));
+  commandTimeoutSeconds_ = new QSpinBox;
+  commandTimeoutSeconds_->setRange(0, 24 * 60 * 60);
+  commandTimeoutSeconds_->setSuffix(" s");
+  commandTimeoutSeconds_->setSpecialValueText("Never");
+  commandTimeoutSeconds_->setValue(settings->commandTimeoutSeconds());
+  timeoutRow->addWidget(commandTimeoutSeconds_);
+  timeoutRow->addStretch();
+
+  QHBoxLayout* saveRow = new QHBoxLayout;
+  layout->addLayout(saveRow);
+  runOnSave_ = new QCheckBox("Run when saves pause for");
+  runOnSave_->setChecked(settings->runOnSave());
+  saveRow->addWidget(runOnSave_);
+  saveDebounceMs_ = new QSpinBox;
+  saveDebounceMs_->setRange(0, 60 * 1000);
+  saveDebounceMs_->setSuffix(" ms");
+  saveDebounceMs_->setValue(settings->saveDebounceMs());
+  saveDebounceMs_->setEnabled(settings->runOnSave());
+  saveRow->addWidget(saveDebounceMs_);
+  saveRow->addStretch();
+
+  connect(runOnSave_, &QCheckBox::toggled, saveDebounceMs_, &QSpinBox::setEnabled);
+
+  // Only the options for what the command runs on apply, and runs on save pass the saved file's
+  // folder just as the current folder target does
+  const auto updateTargetOptions = [this] {
+    const auto target = Settings::CommandTarget(commandTarget_->currentIndex());
+    passFilename_->setEnabled(
+        target == Settings::CommandTarget::CurrentFolder || runOnSave_->isChecked());
+    commandFileList_->setEnabled(target == Settings::CommandTarget::FileList);
+    commandTimeoutSeconds_->setEnabled(target != Settings::CommandTarget::CurrentFolder);
+  };
+  updateTargetOptions();
+  connect(commandTarget_, &QComboBox::currentIndexChanged, this, updateTargetOptions);
+  connect(runOnSave_, &QCheckBox::toggled, this, updateTargetOptions);
+
+  QHBoxLayout* labelsRow = new QHBoxLayout;
+  layout->addLayout(labelsRow);
+  multiKeyLabels_ = new QCheckBox("Label every match with key sequences when single keys run out");
+  multiKeyLabels_->setChecked(settings->multiKeyLabels());
+  labelsRow->addWidget(multiKeyLabels_);
+
+  QHBoxLayout* keyboardRow = new QHBoxLayout;
+  layout->addLayout(keyboardRow);
+  keyboardRow->addWidget(new QLabel("Label keys for:"));
+  keyboardLayout_ = new QComboBox;
+  keyboardLayout_->addItem("QWERTY");
+  keyboardLayout_->addItem("Colemak");
+  keyboardLayout_->addItem("Dvorak");
+  keyboardLayout_->addItem("Workman");
+  keyboardLayout_->addItem("Custom");
+  keyboardLayout_->setCurrentIndex(int(settings->keyboardLayout()));
+  keyboardRow->addWidget(keyboardLayout_);
+  customLayout_ = new QLineEdit(QString::fromStdString(settings->customLayout()));
+  customLayout_->setPlaceholderText("30 keys, top row first, e.g. qwertyuiopasdfghjkl;zxcvbnm,./");
+  customLayout_->setEnabled(settings->keyboardLayout() == Settings::KeyboardLayout::Custom);
+  keyboardRow->addWidget(customLayout_);
+
+  connect(keyboardLayout_, &QComboBox::currentIndexChanged, customLayout_, [this](const int index) {
+    customLayout_->setEnabled(Settings::KeyboardLayout(index) == Settings::KeyboardLayout::Custom);
+  });
+
+  QHBoxLayout* bigramRow = new QHBoxLayout;
+  layout->addLayout(bigramRow);
+  bigramQuery_ = new QCheckBox("Type two characters before labelling matches");
+  bigramQuery_->setChecked(settings->bigramQuery());
+  bigramRow->addWidget(bigramQuery_);
+
+  QHBoxLayout* indexRow = new QHBoxLayout;
+  layout->addLayout(indexRow);
+  indexRow->addWidget(new QLabel("Index documents for instant jumps using at most:"));
+  indexBudgetMegabytes_ = new QSpinBox;
+  indexBudgetMegabytes_->setRange(0, 4096);
+  indexBudgetMegabytes_->setSuffix(" MB");
+  indexBudgetMegabytes_->setSpecialValueText("Off");
+  indexBudgetMegabytes_->setValue(settings->indexBudgetMegabytes());
+  indexRow->addWidget(indexBudgetMegabytes_);
+  indexRow->addStretch();
+
+  QHBoxLayout* scopeRow = new QHBoxLayout;
+  layout->addLayout(scopeRow);
+  scopeRow->addWidget(new QLabel("Search:"));
+  searchScope_ = new QComboBox;
+  searchScope_->addItem("The visible text");
+  searchScope_->addItem("Lines around the cursor");
+  searchScope_->addItem("The whole document");
+  searchScope_->setCurrentIndex(int(settings->searchScope()));
+  scopeRow->addWidget(searchScope_);
+  windowLines_ = new QSpinBox;
+  windowLines_->setRange(1, 1000000);
+  windowLines_->setSuffix(" lines either side");
+  windowLines_->setValue(settings->windowLines());
+  windowLines_->setEnabled(settings->searchScope() == Settings::SearchScope::Window);
+  scopeRow->addWidget(windowLines_);
+  scopeRow->addStretch();
+
+  connect(searchScope_, &QComboBox::currentIndexChanged, windowLines_, [this](const int index) {
+    windowLines_->setEnabled(Settings::SearchScope(index) == Settings::SearchScope::Window);
+  });
+
+  QHBoxLayout* splitsRow = new QHBoxLayout;
+  layout->addLayout(splitsRow);
+  allSplits_ = new QCheckBox("Jump across every visible split");
+  allSplits_->setChecked(settings->allSplits());
+  splitsRow->addWidget(allSplits_);
+
   layout->addSpacerItem(new QSpacerItem(1, 1, QSizePolicy::Expanding, QSizePolicy::Expanding));
 }
 
@@ -34,6 +158,19 @@ Settings OptPageMainWidget::GenerateSettings() const {
   Settings settings;
   settings.passFilename(passFilename_->isChecked());
   settings.command(command_->text().toStdString());
+  settings.commandTarget(Settings::CommandTarget(commandTarget_->currentIndex()));
+  settings.commandFileList(commandFileList_->text().toStdString());
+  settings.commandTimeoutSeconds(commandTimeoutSeconds_->value());
+  settings.runOnSave(runOnSave_->isChecked());
+  settings.saveDebounceMs(saveDebounceMs_->value());
+  settings.multiKeyLabels(multiKeyLabels_->isChecked());
+  settings.keyboardLayout(Settings::KeyboardLayout(keyboardLayout_->currentIndex()));
+  settings.customLayout(customLayout_->text().toStdString());
+  settings.bigramQuery(bigramQuery_->isChecked());
+  settings.indexBudgetMegabytes(indexBudgetMegabytes_->value());
+  settings.searchScope(Settings::SearchScope(searchScope_->currentIndex()));
+  settings.windowLines(windowLines_->value());
+  settings.allSplits(allSplits_->isChecked());
   return settings;
 }
 
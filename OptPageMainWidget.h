@@ -3,7 +3,9 @@
 #include <QWidget>
 
 class QCheckBox;
+class QComboBox;
 class QLineEdit;
+class QSpinBox;
 
 namespace Qtmotion {
 
@@ -20,6 +22,19 @@ class OptPageMainWidget : public QWidget {
  private:
   QCheckBox* passFilename_ = nullptr;
   QLineEdit* command_ = nullptr;
+  QComboBox* commandTarget_ = nullptr;
+  QLineEdit* commandFileList_ = nullptr;
+  QSpinBox* commandTimeoutSeconds_ = nullptr;
+  QCheckBox* runOnSave_ = nullptr;
+  QSpinBox* saveDebounceMs_ = nullptr;
+  QCheckBox* multiKeyLabels_ = nullptr;
+  QComboBox* keyboardLayout_ = nullptr;
+  QLineEdit* customLayout_ = nullptr;
+  QSpinBox* indexBudgetMegabytes_ = nullptr;
+  QComboBox* searchScope_ = nullptr;
+  QSpinBox* windowLines_ = nullptr;
+  QCheckBox* allSplits_ = nullptr;
+  QCheckBox* bigramQuery_ = nullptr;
 };
 
 } // namespace Qtmotion
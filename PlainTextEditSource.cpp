@@ -0,0 +1,125 @@
+#include "PlainTextEditSource.h"
+
+#include <algorithm>
+
+#include <QPlainTextEdit>
+#include <QTextBlock>
+#include <QTextDocument>
+#include <QTextLayout>
+
+namespace Qtmotion {
+PlainTextEditSource::PlainTextEditSource(QPlainTextEdit* textEdit) : textEdit_(textEdit) {}
+
+std::vector<TextSpan> PlainTextEditSource::visibleSpans() const {
+  std::vector<TextSpan> spans;
+
+  const QRect viewport = textEdit_->viewport()->rect();
+
+  // Only the line fragments actually on screen, so a long unwrapped line contributes the columns
+  // in view and a long wrapped one only the rows in view
+  for (QTextBlock block = textEdit_->cursorForPosition(viewport.topLeft()).block();
+       block.isValid();
+       block = block.next()) {
+    const QTextLayout* layout = block.layout();
+
+    if (!block.isVisible() || layout == nullptr || layout->lineCount() == 0) {
+      continue;
+    }
+
+    // Where the block's layout sits in viewport coordinates, found from its first line
+    const QTextLine firstLine = layout->lineAt(0);
+    const QRect firstRect = textEdit_->cursorRect(QTextCursor(block));
+    const qreal originX = firstRect.left() - firstLine.cursorToX(firstLine.textStart());
+    const qreal originY = firstRect.top() - firstLine.y();
+
+    if (originY + firstLine.y() > viewport.bottom()) {
+      break;
+    }
+
+    for (int i = 0; i < layout->lineCount(); i++) {
+      const QTextLine line = layout->lineAt(i);
+      const qreal top = originY + line.y();
+
+      if (top > viewport.bottom()) {
+        break;
+      }
+
+      if (top + line.height() <= viewport.top() || line.textLength() == 0) {
+        continue;
+      }
+
+      int first = line.xToCursor(viewport.left() - originX, QTextLine::CursorOnCharacter);
+      int last = line.xToCursor(viewport.right() - originX, QTextLine::CursorOnCharacter);
+
+      if (first > last) {
+        std::swap(first, last);
+      }
+
+      first = std::max(first, line.textStart());
+      last = std::min(last, line.textStart() + line.textLength() - 1);
+
+      if (first <= last) {
+        spans.push_back(
+            TextSpan{.start = block.position() + first, .end = block.position() + last});
+      }
+    }
+  }
+
+  return spans;
+}
+
+int PlainTextEditSource::cursorPosition() const {
+  return textEdit_->textCursor().position();
+}
+
+int PlainTextEditSource::revision() const {
+  return textEdit_->document()->revision();
+}
+
+QChar PlainTextEditSource::characterAt(const int position) const {
+  return textEdit_->document()->characterAt(position);
+}
+
+QStringView PlainTextEditSource::characters(
+    const int position,
+    const int length,
+    QString& scratch) const {
+  const QTextDocument* document = textEdit_->document();
+
+  // Copying the whole document out in one go beats walking most of its blocks
+  if (length >= document->characterCount() / 2) {
+    scratch = document->toRawText();
+    const qsizetype start = std::min(qsizetype(position), scratch.size());
+    return QStringView(scratch).mid(start, std::min(qsizetype(length), scratch.size() - start));
+  }
+
+  scratch.clear();
+
+  const int limit = position + length - 1;
+
+  for (QTextBlock block = document->findBlock(position);
+       block.isValid() && block.position() <= limit;
+       block = block.next()) {
+    const QString text = block.text();
+    const int blockPos = block.position();
+
+    // Each block ends in a paragraph separator, as QTextDocument::characterAt reports it
+    const int separatorPos = blockPos + int(text.length());
+    const int first = std::max(blockPos, position);
+    const int last = std::min(separatorPos, limit);
+
+    if (first > last) {
+      continue;
+    }
+
+    scratch.append(
+        QStringView(text).mid(first - blockPos, std::min(last, separatorPos - 1) - first + 1));
+
+    if (last == separatorPos) {
+      scratch.append(QChar::ParagraphSeparator);
+    }
+  }
+
+  return scratch;
+}
+} // namespace Qtmotion
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "TextSource.h"
+
+class QPlainTextEdit;
+
+namespace Qtmotion {
+// Reads the document, viewport and cursor of a live editor
+class PlainTextEditSource : public TextSource {
+ public:
+  explicit PlainTextEditSource(QPlainTextEdit* textEdit);
+
+  std::vector<TextSpan> visibleSpans() const override;
+  int cursorPosition() const override;
+  int revision() const override;
+  QChar characterAt(int position) const override;
+  QStringView characters(int position, int length, QString& scratch) const override;
+
+ private:
+  QPlainTextEdit* textEdit_ = nullptr;
+};
+} // namespace Qtmotion
@@ -3,6 +3,7 @@
 #include <iostream>
 
 #include <coreplugin/actionmanager/actionmanager.h>
+#include <coreplugin/editormanager/editormanager.h>
 #include <coreplugin/icore.h>
 
 #include <QAction>
@@ -22,6 +23,20 @@ bool Plugin::initialize(const QStringList&, QString*) {
   optionsPage_ = std::make_unique<OptPageMain>(settings_.get(), this);
   connect(optionsPage_.get(), &OptPageMain::SettingsChanged, this, &Plugin::updateCommand);
 
+  // Index documents as they open so the first jump in them is already instant
+  connect(
+      Core::EditorManager::instance(),
+      &Core::EditorManager::editorOpened,
+      handler_.get(),
+      &EventHandler::indexEditor);
+
+  // Saves can re-run the command, which the handler only does when the options ask for it
+  connect(
+      Core::EditorManager::instance(),
+      &Core::EditorManager::saved,
+      handler_.get(),
+      &EventHandler::documentSaved);
+
   QAction* searchBeforeChar = new QAction(tr("Search before char"), this);
   constexpr std::string_view kSearchBeforeId = "Qtmotion.SearchBeforeChar";
   Core::Command* searchBeforeCmd = Core::ActionManager::registerAction(
@@ -58,6 +73,47 @@ bool Plugin::initialize(const QStringList&, QString*) {
   selectAfterCmd->setDefaultKeySequence(QKeySequence(tr("Ctrl+>")));
   connect(selectAfterChar, SIGNAL(triggered()), handler_.get(), SLOT(triggerAfterCharSelect()));
 
+  // Boundary jumps have no default shortcuts, to stay clear of Qt Creator's own
+  QAction* jumpWordStart = new QAction(tr("Jump to word start"), this);
+  constexpr std::string_view kJumpWordStartId = "Qtmotion.JumpWordStart";
+  Core::ActionManager::registerAction(
+      jumpWordStart,
+      std::string(kJumpWordStartId).c_str(),
+      Core::Context(Core::Constants::C_EDIT_MODE));
+  connect(jumpWordStart, SIGNAL(triggered()), handler_.get(), SLOT(triggerWordStart()));
+
+  QAction* jumpLineStart = new QAction(tr("Jump to line start"), this);
+  constexpr std::string_view kJumpLineStartId = "Qtmotion.JumpLineStart";
+  Core::ActionManager::registerAction(
+      jumpLineStart,
+      std::string(kJumpLineStartId).c_str(),
+      Core::Context(Core::Constants::C_EDIT_MODE));
+  connect(jumpLineStart, SIGNAL(triggered()), handler_.get(), SLOT(triggerLineStart()));
+
+  QAction* jumpLineEnd = new QAction(tr("Jump to line end"), this);
+  constexpr std::string_view kJumpLineEndId = "Qtmotion.JumpLineEnd";
+  Core::ActionManager::registerAction(
+      jumpLineEnd,
+      std::string(kJumpLineEndId).c_str(),
+      Core::Context(Core::Constants::C_EDIT_MODE));
+  connect(jumpLineEnd, SIGNAL(triggered()), handler_.get(), SLOT(triggerLineEnd()));
+
+  QAction* jumpCamelHump = new QAction(tr("Jump to CamelCase hump"), this);
+  constexpr std::string_view kJumpCamelHumpId = "Qtmotion.JumpCamelHump";
+  Core::ActionManager::registerAction(
+      jumpCamelHump,
+      std::string(kJumpCamelHumpId).c_str(),
+      Core::Context(Core::Constants::C_EDIT_MODE));
+  connect(jumpCamelHump, SIGNAL(triggered()), handler_.get(), SLOT(triggerCamelHump()));
+
+  QAction* jumpPunctuation = new QAction(tr("Jump to punctuation"), this);
+  constexpr std::string_view kJumpPunctuationId = "Qtmotion.JumpPunctuation";
+  Core::ActionManager::registerAction(
+      jumpPunctuation,
+      std::string(kJumpPunctuationId).c_str(),
+      Core::Context(Core::Constants::C_EDIT_MODE));
+  connect(jumpPunctuation, SIGNAL(triggered()), handler_.get(), SLOT(triggerPunctuation()));
+
   QAction* runCommand = new QAction(tr("Run command"), this);
   constexpr std::string_view kRunCommand = "Qtmotion.RunCommand";
   Core::Command* runCommandCmd = Core::ActionManager::registerAction(
@@ -0,0 +1,69 @@
+#include "SaveTrigger.h"
+
+#include <QFileInfo>
+
+namespace Qtmotion {
+void SaveTrigger::setCommand(
+    const QString& command,
+    const bool passFolder,
+    const std::chrono::milliseconds debounce) {
+  if (command == command_ && passFolder == passFolder_ && debounce == debounce_) {
+    return;
+  }
+
+  // Runs already going finish as they were, but nothing waiting starts with the old settings
+  for (const auto& [key, folder] : folders_) {
+    folder->debounce.stop();
+  }
+
+  command_ = command;
+  passFolder_ = passFolder;
+  debounce_ = debounce;
+}
+
+void SaveTrigger::fileSaved(const QString& path) {
+  if (command_.isEmpty()) {
+    return;
+  }
+
+  // Restarting the wait folds a burst of saves into the one run
+  folderFor(passFolder_ ? QFileInfo(path).absolutePath() : QString()).debounce.start(debounce_);
+}
+
+void SaveTrigger::runNow(const QString& command, const QString& folder) {
+  Folder& entry = folderFor(folder);
+
+  // The saves it was waiting on are covered by this run
+  entry.debounce.stop();
+  entry.runner.run(
+      folder.isEmpty() ? command : command + ' ' + CommandRunner::shellQuote(folder));
+}
+
+SaveTrigger::Folder& SaveTrigger::folderFor(const QString& key) {
+  std::unique_ptr<Folder>& folder = folders_[key];
+
+  if (!folder) {
+    folder = std::make_unique<Folder>();
+    folder->debounce.setSingleShot(true);
+    connect(&folder->debounce, &QTimer::timeout, this, [this, key] { runNow(command_, key); });
+
+    // Queued, as the runner can't be deleted while it's still emitting
+    connect(
+        &folder->runner,
+        &CommandRunner::finished,
+        this,
+        [this, key] { prune(key); },
+        Qt::QueuedConnection);
+  }
+
+  return *folder;
+}
+
+void SaveTrigger::prune(const QString& key) {
+  const auto it = folders_.find(key);
+
+  if (it != folders_.end() && !it->second->debounce.isActive() && !it->second->runner.isRunning()) {
+    folders_.erase(it);
+  }
+}
+} // namespace Qtmotion
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <memory>
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include "CommandRunner.h"
+
+namespace Qtmotion {
+// Runs the command after files are saved, once a burst of saves has settled, and on demand. Each
+// folder has at most one run waiting and one going, and a run that's due replaces one still going
+// whichever of the two started it.
+class SaveTrigger : public QObject {
+  Q_OBJECT
+
+ public:
+  // An empty command stops runs on save. With passFolder the saved file's folder is appended, and
+  // each folder is debounced and run on its own.
+  void setCommand(const QString& command, bool passFolder, std::chrono::milliseconds debounce);
+
+  void fileSaved(const QString& path);
+
+  // Runs command straight away in place of any run waiting or going for folder, or for everything
+  // with an empty folder, which is then not appended
+  void runNow(const QString& command, const QString& folder);
+
+ private:
+  struct Folder {
+    QTimer debounce;
+    CommandRunner runner;
+  };
+
+  Folder& folderFor(const QString& key);
+
+  // Drops a folder once it has nothing waiting or going
+  void prune(const QString& key);
+
+  QString command_;
+  bool passFolder_ = false;
+  std::chrono::milliseconds debounce_{0};
+
+  // Keyed by folder, or by an empty string for everything when no folder is passed
+  std::map<QString, std::unique_ptr<Folder>> folders_;
+};
+} // namespace Qtmotion
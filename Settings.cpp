@@ -1,5 +1,7 @@
 #include "Settings.h"
 
+#include <algorithm>
+
 #include <coreplugin/icore.h>
 
 namespace Qtmotion {
@@ -11,6 +13,22 @@ void Settings::Load() {
   s->beginGroup("QT_MOTION");
   passFilename_ = s->value("PASS_FILENAME", false).toBool();
   command_ = s->value("COMMAND", QString()).toString().toStdString();
+  commandTarget_ = CommandTarget(
+      std::clamp(s->value("COMMAND_TARGET", 0).toInt(), 0, int(CommandTarget::FileList)));
+  commandFileList_ = s->value("COMMAND_FILE_LIST", QString()).toString().toStdString();
+  commandTimeoutSeconds_ = s->value("COMMAND_TIMEOUT_S", 60).toInt();
+  runOnSave_ = s->value("RUN_ON_SAVE", false).toBool();
+  saveDebounceMs_ = s->value("SAVE_DEBOUNCE_MS", 500).toInt();
+  multiKeyLabels_ = s->value("MULTI_KEY_LABELS", false).toBool();
+  keyboardLayout_ = KeyboardLayout(
+      std::clamp(s->value("KEYBOARD_LAYOUT", 0).toInt(), 0, int(KeyboardLayout::Custom)));
+  customLayout_ = s->value("CUSTOM_LAYOUT", QString()).toString().toStdString();
+  indexBudgetMegabytes_ = s->value("INDEX_BUDGET_MB", 64).toInt();
+  searchScope_ = SearchScope(
+      std::clamp(s->value("SEARCH_SCOPE", 0).toInt(), 0, int(SearchScope::Document)));
+  windowLines_ = s->value("WINDOW_LINES", 1000).toInt();
+  allSplits_ = s->value("ALL_SPLITS", false).toBool();
+  bigramQuery_ = s->value("BIGRAM_QUERY", false).toBool();
   s->endGroup();
 }
 
@@ -19,6 +37,19 @@ void Settings::Save() {
   s->beginGroup("QT_MOTION");
   s->setValue("PASS_FILENAME", passFilename_);
   s->setValue("COMMAND", QString::fromStdString(command_));
+  s->setValue("COMMAND_TARGET", int(commandTarget_));
+  s->setValue("COMMAND_FILE_LIST", QString::fromStdString(commandFileList_));
+  s->setValue("COMMAND_TIMEOUT_S", commandTimeoutSeconds_);
+  s->setValue("RUN_ON_SAVE", runOnSave_);
+  s->setValue("SAVE_DEBOUNCE_MS", saveDebounceMs_);
+  s->setValue("MULTI_KEY_LABELS", multiKeyLabels_);
+  s->setValue("KEYBOARD_LAYOUT", int(keyboardLayout_));
+  s->setValue("CUSTOM_LAYOUT", QString::fromStdString(customLayout_));
+  s->setValue("INDEX_BUDGET_MB", indexBudgetMegabytes_);
+  s->setValue("SEARCH_SCOPE", int(searchScope_));
+  s->setValue("WINDOW_LINES", windowLines_);
+  s->setValue("ALL_SPLITS", allSplits_);
+  s->setValue("BIGRAM_QUERY", bigramQuery_);
   s->endGroup();
 }
 
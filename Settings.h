@@ -6,6 +6,15 @@ namespace Qtmotion {
 
 class Settings {
  public:
+  // How much of the document a jump searches
+  enum class SearchScope { Visible, Window, Document };
+
+  // What the command runs on, either once or once per file
+  enum class CommandTarget { CurrentFolder, OpenDocuments, FileList };
+
+  // Which keyboard the label keys are ordered for
+  enum class KeyboardLayout { Qwerty, Colemak, Dvorak, Workman, Custom };
+
   Settings();
 
   bool passFilename() const;
@@ -14,6 +23,53 @@ class Settings {
   const std::string& command() const;
   void command(const std::string& value);
 
+  CommandTarget commandTarget() const;
+  void commandTarget(const CommandTarget value);
+
+  // A file naming the files to run the command on, one per line, relative to its own folder
+  const std::string& commandFileList() const;
+  void commandFileList(const std::string& value);
+
+  // Longest each run of the command may take when running once per file, 0 for no limit
+  int commandTimeoutSeconds() const;
+  void commandTimeoutSeconds(const int value);
+
+  // Whether saving a file runs the command on its folder, once saves pause for the debounce
+  bool runOnSave() const;
+  void runOnSave(const bool value);
+
+  int saveDebounceMs() const;
+  void saveDebounceMs(const int value);
+
+  bool multiKeyLabels() const;
+  void multiKeyLabels(const bool value);
+
+  KeyboardLayout keyboardLayout() const;
+  void keyboardLayout(const KeyboardLayout value);
+
+  // The Custom layout's keys as three rows of ten, top row first, read left to right
+  const std::string& customLayout() const;
+  void customLayout(const std::string& value);
+
+  // Largest per-document character index to keep, 0 to never index
+  int indexBudgetMegabytes() const;
+  void indexBudgetMegabytes(const int value);
+
+  SearchScope searchScope() const;
+  void searchScope(const SearchScope value);
+
+  // Lines either side of the cursor searched in the Window scope
+  int windowLines() const;
+  void windowLines(const int value);
+
+  // Whether a jump labels targets in every visible split rather than just the focused editor
+  bool allSplits() const;
+  void allSplits(const bool value);
+
+  // Whether jumps wait for two characters before labelling, as in leap.nvim
+  bool bigramQuery() const;
+  void bigramQuery(const bool value);
+
   void Load();
   void Save();
 
@@ -23,6 +79,19 @@ class Settings {
  private:
   bool passFilename_ = false;
   std::string command_;
+  CommandTarget commandTarget_ = CommandTarget::CurrentFolder;
+  std::string commandFileList_;
+  int commandTimeoutSeconds_ = 60;
+  bool runOnSave_ = false;
+  int saveDebounceMs_ = 500;
+  bool multiKeyLabels_ = false;
+  KeyboardLayout keyboardLayout_ = KeyboardLayout::Qwerty;
+  std::string customLayout_;
+  int indexBudgetMegabytes_ = 64;
+  SearchScope searchScope_ = SearchScope::Visible;
+  int windowLines_ = 1000;
+  bool allSplits_ = false;
+  bool bigramQuery_ = false;
 };
 
 inline bool Settings::passFilename() const {
@@ -40,8 +109,120 @@ inline void Settings::command(const std::string& value) {
   command_ = value;
 }
 
+inline Settings::CommandTarget Settings::commandTarget() const {
+  return commandTarget_;
+}
+
+inline void Settings::commandTarget(const CommandTarget value) {
+  commandTarget_ = value;
+}
+
+inline const std::string& Settings::commandFileList() const {
+  return commandFileList_;
+}
+
+inline void Settings::commandFileList(const std::string& value) {
+  commandFileList_ = value;
+}
+
+inline int Settings::commandTimeoutSeconds() const {
+  return commandTimeoutSeconds_;
+}
+
+inline void Settings::commandTimeoutSeconds(const int value) {
+  commandTimeoutSeconds_ = value;
+}
+
+inline bool Settings::runOnSave() const {
+  return runOnSave_;
+}
+
+inline void Settings::runOnSave(const bool value) {
+  runOnSave_ = value;
+}
+
+inline int Settings::saveDebounceMs() const {
+  return saveDebounceMs_;
+}
+
+inline void Settings::saveDebounceMs(const int value) {
+  saveDebounceMs_ = value;
+}
+
+inline bool Settings::multiKeyLabels() const {
+  return multiKeyLabels_;
+}
+
+inline void Settings::multiKeyLabels(const bool value) {
+  multiKeyLabels_ = value;
+}
+
+inline Settings::KeyboardLayout Settings::keyboardLayout() const {
+  return keyboardLayout_;
+}
+
+inline void Settings::keyboardLayout(const KeyboardLayout value) {
+  keyboardLayout_ = value;
+}
+
+inline const std::string& Settings::customLayout() const {
+  return customLayout_;
+}
+
+inline void Settings::customLayout(const std::string& value) {
+  customLayout_ = value;
+}
+
+inline int Settings::indexBudgetMegabytes() const {
+  return indexBudgetMegabytes_;
+}
+
+inline void Settings::indexBudgetMegabytes(const int value) {
+  indexBudgetMegabytes_ = value;
+}
+
+inline Settings::SearchScope Settings::searchScope() const {
+  return searchScope_;
+}
+
+inline void Settings::searchScope(const SearchScope value) {
+  searchScope_ = value;
+}
+
+inline int Settings::windowLines() const {
+  return windowLines_;
+}
+
+inline void Settings::windowLines(const int value) {
+  windowLines_ = value;
+}
+
+inline bool Settings::allSplits() const {
+  return allSplits_;
+}
+
+inline void Settings::allSplits(const bool value) {
+  allSplits_ = value;
+}
+
+inline bool Settings::bigramQuery() const {
+  return bigramQuery_;
+}
+
+inline void Settings::bigramQuery(const bool value) {
+  bigramQuery_ = value;
+}
+
 inline bool Settings::operator==(const Settings& other) const {
-  return passFilename_ == other.passFilename_ && command_ == other.command_;
+  return passFilename_ == other.passFilename_ && command_ == other.command_ &&
+      commandTarget_ == other.commandTarget_ && commandFileList_ == other.commandFileList_ &&
+      commandTimeoutSeconds_ == other.commandTimeoutSeconds_ && runOnSave_ == other.runOnSave_ &&
+      saveDebounceMs_ == other.saveDebounceMs_ &&
+      multiKeyLabels_ == other.multiKeyLabels_ && keyboardLayout_ == other.keyboardLayout_ &&
+      customLayout_ == other.customLayout_ &&
+      indexBudgetMegabytes_ == other.indexBudgetMegabytes_ &&
+      searchScope_ == other.searchScope_ && windowLines_ == other.windowLines_ &&
+      allSplits_ == other.allSplits_ && bigramQuery_ == other.bigramQuery_;
 }
 
 inline bool Settings::operator!=(const Settings& other) const {
@@ -1,127 +1,813 @@
 #include "TargetString.h"
 
+#include "DocumentIndex.h"
+#include "MatchKernel.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <functional>
 #include <iostream>
+#include <iterator>
 #include <unordered_set>
+#include <utility>
 
-#include <QPlainTextEdit>
-#include <QTextDocument>
+#include <QVarLengthArray>
+#include <QtConcurrent>
 
 namespace Qtmotion {
-void TargetString::appendQuery(QPlainTextEdit* textEdit, const QChar& query) {
-  findMatchingPositions(textEdit, query, query_, selectables_, potentialSelectables_);
+namespace {
+// Interleaves ascending hits into the order of walking outward from the cursor one character at a
+// time, taking the position after the cursor first when both sides are equally distant
+std::vector<int> mergeNearestFirst(const std::vector<int>& ascending, const int cursorPos) {
+  std::vector<int> merged;
+  merged.reserve(ascending.size());
+
+  const auto pivot = std::upper_bound(ascending.begin(), ascending.end(), cursorPos);
+  auto after = pivot;
+  auto before =
+      std::make_reverse_iterator(std::lower_bound(ascending.begin(), pivot, cursorPos));
+
+  while (after != ascending.end() || before != ascending.rend()) {
+    if (after != ascending.end() &&
+        (before == ascending.rend() || *after - cursorPos <= cursorPos - *before)) {
+      merged.push_back(*after++);
+    } else {
+      merged.push_back(*before++);
+    }
+  }
+
+  return merged;
+}
+
+// The parts of range not covered by the ascending spans
+std::vector<TextSpan> subtractSpans(const TextSpan& range, const std::vector<TextSpan>& spans) {
+  std::vector<TextSpan> remainder;
+  int start = range.start;
+
+  for (const TextSpan& span : spans) {
+    if (span.start > start) {
+      remainder.push_back(TextSpan{.start = start, .end = std::min(span.start - 1, range.end)});
+    }
+
+    start = std::max(start, span.end + 1);
+  }
+
+  if (start <= range.end) {
+    remainder.push_back(TextSpan{.start = start, .end = range.end});
+  }
+
+  return remainder;
+}
+} // namespace
+
+TargetString::TargetString() {
+  scanTimer_.setSingleShot(true);
+  scanTimer_.setInterval(0);
+  connect(&scanTimer_, &QTimer::timeout, this, &TargetString::scanNextSlice);
+
+  labelTimer_.setSingleShot(true);
+  labelTimer_.setInterval(0);
+  connect(&labelTimer_, &QTimer::timeout, this, [this] {
+    labelStreamedMatches();
+    emit candidatesChanged();
+  });
+
+  // Results arrive a ring at a time and in order, so each one finishes the first pending ring
+  connect(
+      &stream_,
+      &QFutureWatcherBase::resultsReadyAt,
+      this,
+      [this](const int begin, const int end) {
+        for (int i = begin; i < end && !pendingOffscreen_.empty(); i++) {
+          pendingOffscreen_.next++;
+          const std::vector<int> positions = stream_.resultAt(i);
+          streamed_.insert(streamed_.end(), positions.begin(), positions.end());
+        }
+
+        // The worker has scanned all the snapshot held, so ask for the next batch
+        if (!pendingOffscreen_.empty() && pendingOffscreen_.next == snapshotRings_) {
+          continueScan();
+        }
+
+        // However many rings arrive before the next frame, they're labelled together. Even
+        // without matches the overlay has to hear the search has got further.
+        if (!labelTimer_.isActive()) {
+          labelTimer_.start();
+        }
+      });
 }
 
-void TargetString::findMatchingPositions(
-    QPlainTextEdit* textEdit,
-    const QChar& query,
-    QString& aggregateQuery,
-    std::vector<Target>& selectables,
-    std::vector<Target>& potentialSelectables) {
-  if (textEdit == nullptr) {
+TargetString::~TargetString() {
+  reset();
+}
+
+void TargetString::prepare(const TextSource& source, const bool firstKeyTable) {
+  const TraceScope trace("prepare");
+
+  const std::vector<TextSpan> spans = source.visibleSpans();
+  const int origin = jumpOrigin(spans, source.cursorPosition());
+
+  takeSnapshot(source, spans);
+
+  prepared_ = Prepared{
+      .spans = spans, .origin = origin, .revision = source.revision(), .bigrams = bigramQuery_};
+
+  // An up to date index answers the first key just as quickly
+  if (firstKeyTable && (!index_ || !index_->isIdle())) {
+    // The workers hold copies of the segments, and with them references to the storage, so the
+    // table can be dropped without waiting for it. Views of the source's own memory aren't owned
+    // by anyone, so those few screens are copied.
+    for (Segment& segment : segments_) {
+      const QChar* storage = segment.storage.constData();
+
+      if (segment.text.data() < storage ||
+          segment.text.data() + segment.text.size() > storage + segment.storage.size()) {
+        segment.storage = segment.text.toString();
+        segment.text = segment.storage;
+      }
+    }
+
+    // Segments are far apart, like the screens of different editors, so each gets its own worker
+    prepared_->table = QtConcurrent::mappedReduced<FirstKeyTable>(
+        segments_,
+        [spans, bigrams = bigramQuery_](const Segment& segment) {
+          return buildFirstKeyTable(spans, segment, bigrams);
+        },
+        [](FirstKeyTable& table, const FirstKeyTable& part) {
+          for (const auto& [key, positions] : part) {
+            std::vector<int>& all = table[key];
+            all.insert(all.end(), positions.begin(), positions.end());
+          }
+        },
+        QtConcurrent::OrderedReduce);
+  }
+}
+
+void TargetString::setIndex(const DocumentIndex* index) {
+  index_ = index;
+}
+
+void TargetString::setSearchRange(const std::optional<TextSpan>& range) {
+  searchRange_ = range;
+}
+
+bool TargetString::isSearching() const {
+  return !pendingVisible_.empty() || !pendingOffscreen_.empty();
+}
+
+void TargetString::appendQuery(const TextSource& source, const QChar& query) {
+  // The first of a pair only waits for the second, which matches both at once
+  if (bigramQuery_ && query_.isEmpty() && !boundaryJump_) {
+    generations_.push_back(Generation{});
+    query_ += query;
     return;
   }
 
-  QTextDocument* doc = textEdit->document();
+  findMatchingPositions(source, query);
+}
+
+void TargetString::jumpToBoundaries(const TextSource& source, const Boundary boundary) {
+  const TraceScope trace("boundaries");
+
+  cancelScan();
 
-  std::vector<int> matchingPositions;
+  const std::vector<TextSpan> spans = source.visibleSpans();
+  origin_ = jumpOrigin(spans, source.cursorPosition());
+  boundaryJump_ = true;
 
-  // First time new query
-  if (aggregateQuery.length() == 0) {
-    int cursorPos = textEdit->textCursor().position();
+  std::vector<int> positions;
 
-    const QPoint bottomRight(textEdit->viewport()->width() - 1, textEdit->viewport()->height() - 1);
-    const int startPos = textEdit->cursorForPosition(QPoint(0, 0)).position();
-    const int endPos = textEdit->cursorForPosition(bottomRight).position();
+  // Runs only see their own characters, so the ones either side come from the snapshot or source
+  forEachSnapshotRun(
+      spans, segments_, [&](const char16_t* data, const int length, const int start) {
+        findBoundaries(
+            data,
+            length,
+            characterAt(source, start - 1),
+            characterAt(source, start + length),
+            boundary,
+            start,
+            positions);
+      });
+
+  assignLabels(source, mergeNearestFirst(positions, origin_));
+}
 
-    // Cursor currently offscreen
-    if (cursorPos < startPos || cursorPos > endPos) {
-      cursorPos = (startPos + endPos) / 2;
+int TargetString::jumpOrigin(const std::vector<TextSpan>& spans, const int cursorPos) {
+  // Cursor currently offscreen
+  if (!spans.empty() && (cursorPos < spans.front().start || cursorPos > spans.back().end)) {
+    return (spans.front().start + spans.back().end) / 2;
+  }
+
+  return cursorPos;
+}
+
+template <typename Fn>
+void TargetString::forEachSnapshotRun(
+    const std::vector<TextSpan>& spans,
+    const std::vector<Segment>& segments,
+    Fn&& fn) {
+  auto segment = segments.begin();
+
+  for (const TextSpan& span : spans) {
+    int start = span.start;
+
+    while (start <= span.end) {
+      while (segment != segments.end() && start >= segment->start + segment->text.length()) {
+        ++segment;
+      }
+
+      if (segment == segments.end() || segment->start > span.end) {
+        break;
+      }
+
+      start = std::max(start, segment->start);
+
+      const int index = start - segment->start;
+      const int length = std::min(span.end - start + 1, int(segment->text.length()) - index);
+      fn(segment->text.utf16() + index, length, start);
+      start += length;
     }
+  }
+}
+
+TargetString::FirstKeyTable TargetString::buildFirstKeyTable(
+    const std::vector<TextSpan>& spans,
+    const Segment& segment,
+    const bool bigrams) {
+  const TraceScope trace("firstKeyTable");
+
+  std::vector<TextSpan> inside;
+  std::copy_if(spans.begin(), spans.end(), std::back_inserter(inside), [&](const TextSpan& span) {
+    return span.start >= segment.start && span.start < segment.start + segment.text.length();
+  });
 
-    bool notCaseSensitive = query.category() != QChar::Letter_Uppercase;
+  FirstKeyTable table;
 
-    // Go up and down from the current position matching the target query
-    for (int offset = 1; cursorPos - offset >= startPos || cursorPos + offset <= endPos; offset++) {
-      if (cursorPos + offset <= endPos) {
-        QChar c = doc->characterAt(cursorPos + offset);
+  const std::vector<Segment> segments = {segment};
 
-        if (notCaseSensitive) {
-          c = c.toLower();
+  forEachSnapshotRun(
+      inside, segments, [&](const char16_t* data, const int length, const int start) {
+        if (!bigrams) {
+          for (int i = 0; i < length; i++) {
+            table[foldCase(data[i])].push_back(start + i);
+          }
+
+          return;
         }
 
-        if (c == query) {
-          matchingPositions.push_back(cursorPos + offset);
+        // The second character of the last pair is past the run, in the lookahead
+        for (int i = 0; i < length; i++) {
+          const char16_t second =
+              i + 1 < length ? data[i + 1] : characterIn(segments, start + i + 1).unicode();
+          table[bigramKey(foldCase(data[i]), second)].push_back(start + i);
         }
-      }
+      });
 
-      if (cursorPos - offset >= startPos) {
-        QChar c = doc->characterAt(cursorPos - offset);
+  return table;
+}
 
-        if (notCaseSensitive) {
-          c = c.toLower();
-        }
+std::vector<int> TargetString::lookupFirstKey(
+    const TextSource& source,
+    const FirstKeyTable& table,
+    const QString& query) const {
+  const char16_t folded = foldedKey(query.front());
+  const auto found =
+      table.find(query.length() > 1 ? bigramKey(folded, query[1].unicode()) : folded);
+
+  if (found == table.end()) {
+    return {};
+  }
+
+  return mergeNearestFirst(keepMatchingCase(source, found->second, query), origin_);
+}
 
-        if (c == query) {
-          matchingPositions.push_back(cursorPos - offset);
+std::vector<int> TargetString::keepMatchingCase(
+    const TextSource& source,
+    std::vector<int> folded,
+    const QString& query) const {
+  // Uppercase queries only match themselves, not everything that shares their lowercase form
+  const qsizetype first = matchesExactCase(query.front()) ? 0 : 1;
+
+  if (first < query.length()) {
+    std::erase_if(folded, [&](const int position) {
+      for (qsizetype i = first; i < query.length(); i++) {
+        if (characterAt(source, position + int(i)) != query[i]) {
+          return true;
         }
       }
+
+      return false;
+    });
+  }
+
+  return folded;
+}
+
+void TargetString::takeSnapshot(const TextSource& source, const std::vector<TextSpan>& spans) {
+  segments_.clear();
+
+  for (size_t i = 0; i < spans.size();) {
+    // Spans close enough to share lookahead, like the rows of a wrapped line, share a segment
+    const int startPos = spans[i].start;
+    int limit = spans[i].end + kSnapshotLookahead_;
+
+    for (i++; i < spans.size() && spans[i].start <= limit + 1; i++) {
+      limit = std::max(limit, spans[i].end + kSnapshotLookahead_);
+    }
+
+    Segment segment{.start = startPos};
+    segment.text = source.characters(startPos, limit - startPos + 1, segment.storage);
+    segments_.push_back(std::move(segment));
+  }
+}
+
+void TargetString::extendSnapshot(const TextSource& source, const TextSpan& range) {
+  std::vector<TextSpan> held;
+
+  for (const Segment& segment : segments_) {
+    held.push_back(
+        TextSpan{.start = segment.start, .end = segment.start + int(segment.text.length()) - 1});
+  }
+
+  // Each gap runs up to the next segment, so only the last one needs lookahead of its own
+  for (const TextSpan& gap : subtractSpans(range, held)) {
+    const int end = gap.end == range.end ? gap.end + kSnapshotLookahead_ : gap.end;
+
+    Segment segment{.start = gap.start};
+    segment.text = source.characters(gap.start, end - gap.start + 1, segment.storage);
+    segments_.push_back(std::move(segment));
+  }
+
+  std::sort(segments_.begin(), segments_.end(), [](const Segment& a, const Segment& b) {
+    return a.start < b.start;
+  });
+}
+
+QChar TargetString::characterAt(const TextSource& source, const int position) const {
+  const QChar c = snapshotCharacterAt(position);
+  return c.isNull() ? source.characterAt(position) : c;
+}
+
+QChar TargetString::snapshotCharacterAt(const int position) const {
+  return characterIn(segments_, position);
+}
+
+QChar TargetString::characterIn(const std::vector<Segment>& segments, const int position) {
+  auto segment = std::upper_bound(
+      segments.begin(), segments.end(), position, [](const int pos, const Segment& segment) {
+        return pos < segment.start;
+      });
+
+  if (segment != segments.begin()) {
+    --segment;
+
+    if (position - segment->start < segment->text.length()) {
+      return segment->text[position - segment->start];
+    }
+  }
+
+  return QChar();
+}
+
+void TargetString::findMatchingPositions(const TextSource& source, const QChar& query) {
+  const TraceScope trace("match");
+
+  // Whatever was still being scanned for the shorter query is scanned for the whole query below
+  cancelScan();
+
+  // Keep the current generation around so backspace can return to it without rescanning
+  generations_.push_back(Generation{
+      .selectables = std::exchange(selectables_, takeSpareSet()),
+      .potentialSelectables = std::exchange(potentialSelectables_, takeSpareSet()),
+      .pendingVisible = pendingVisible_,
+      .pendingOffscreen = pendingOffscreen_});
+  const Generation& previous = generations_.back();
+
+  std::vector<int>& matchingPositions = matchingPositions_;
+  matchingPositions.clear();
+
+  // First time new query, which in bigram mode is the second key
+  if (!boundaryJump_ && query_.length() == (bigramQuery_ ? 1 : 0)) {
+    const QString first = query_ + query;
+    const std::vector<TextSpan> spans = source.visibleSpans();
+    origin_ = jumpOrigin(spans, source.cursorPosition());
+
+    const bool prepared = prepared_ && prepared_->spans == spans && prepared_->origin == origin_ &&
+        prepared_->revision == source.revision() && prepared_->bigrams == bigramQuery_;
+
+    // The search range always covers what's on screen
+    std::optional<TextSpan> range = searchRange_;
+
+    if (range && !spans.empty()) {
+      range->start = std::min(range->start, spans.front().start);
+      range->end = std::max(range->end, spans.back().end);
+    }
+
+    // Copy the visible range out of the source once, every later keystroke reads from this. What
+    // prepare() took is still good. The rest of the search range is only copied out as the scan
+    // gets to it, so the key doesn't wait on a whole document.
+    if (!prepared) {
+      takeSnapshot(source, spans);
+    }
+
+    const bool indexed = index_ && index_->isIdle();
+
+    if (indexed) {
+      matchingPositions = mergeNearestFirst(
+          keepMatchingCase(source, index_->positions(foldedKey(first.front()), spans), first),
+          origin_);
+    } else if (prepared && prepared_->table.isValid() && prepared_->table.isFinished()) {
+      // Nothing moved or changed since the trigger and the worker has done the scan already.
+      // Waiting for one still running would stall the key, so that falls through to a scan.
+      matchingPositions = lookupFirstKey(source, prepared_->table.result(), first);
+    } else {
+      // Go up and down from the current position in the same order as a character by character
+      // walk, a ring at a time so the scan can be spread over several frames
+      visibleRings_ = buildRings(spans, origin_, kScanChunk_);
+      pendingVisible_ = PendingRings{.next = 0, .end = visibleRings_.size()};
+    }
+
+    // Everything offscreen comes after what can be seen, nearest first again
+    if (range) {
+      const std::vector<TextSpan> offscreen = subtractSpans(*range, spans);
+
+      if (indexed) {
+        const std::vector<int> positions = mergeNearestFirst(
+            keepMatchingCase(
+                source, index_->positions(foldedKey(first.front()), offscreen), first),
+            origin_);
+        matchingPositions.insert(matchingPositions.end(), positions.begin(), positions.end());
+      } else {
+        offscreenRings_ = std::make_shared<const std::vector<Ring>>(
+            buildRings(offscreen, origin_, kStreamChunk_));
+        snapshotRings_ = 0;
+        pendingOffscreen_ = PendingRings{.next = 0, .end = offscreenRings_->size()};
+      }
     }
   } else {
+    // Boundary targets were found without a key, so each key narrows them by case as a first key
+    // would. Otherwise the rest of the query matches exactly.
+    const bool folded = boundaryJump_ && !matchesExactCase(query);
+    const auto matches = [&](const int position) {
+      const QChar c = characterAt(source, position + query_.length());
+      return folded ? foldCase(c.unicode()) == query.unicode() : c == query;
+    };
+
     // If we have run before, clear out incompatible matches
-    for (const auto& selectable : selectables) {
-      if (doc->characterAt(selectable.position + aggregateQuery.length()) == query) {
+    for (const Target selectable : previous.selectables) {
+      if (matches(selectable.position)) {
         matchingPositions.push_back(selectable.position);
       }
     }
 
-    for (const auto& potentialSelectable : potentialSelectables) {
-      if (doc->characterAt(potentialSelectable.position + aggregateQuery.length()) == query) {
+    for (const Target potentialSelectable : previous.potentialSelectables) {
+      if (matches(potentialSelectable.position)) {
         matchingPositions.push_back(potentialSelectable.position);
       }
     }
   }
 
-  selectables.clear();
-  potentialSelectables.clear();
+  query_ += query;
+  selection_.clear();
+
+  // The first slice of the scan is labelled along with everything else, usually finishing it
+  scanVisible(matchingPositions);
+  assignLabels(source, matchingPositions);
+  continueScan();
+}
+
+std::vector<TargetString::Ring> TargetString::buildRings(
+    const std::vector<TextSpan>& spans,
+    const int origin,
+    const int chunk) {
+  std::vector<Ring> rings;
+
+  if (spans.empty()) {
+    return rings;
+  }
+
+  auto clip = [&](const TextSpan& window, Ring& ring) {
+    for (const TextSpan& span : spans) {
+      const TextSpan part{
+          .start = std::max(span.start, window.start), .end = std::min(span.end, window.end)};
+
+      if (part.start <= part.end) {
+        ring.spans.push_back(part);
+      }
+    }
+  };
+
+  for (int distance = 0;
+       origin - distance > spans.front().start || origin + distance < spans.back().end;
+       distance += chunk) {
+    // Both sides of the ring in ascending order, all between distance and distance + chunk away
+    Ring ring;
+    clip(TextSpan{.start = origin - distance - chunk, .end = origin - distance - 1}, ring);
+    clip(TextSpan{.start = origin + distance + 1, .end = origin + distance + chunk}, ring);
+
+    if (!ring.spans.empty()) {
+      rings.push_back(std::move(ring));
+    }
+  }
+
+  return rings;
+}
+
+std::vector<int> TargetString::matchRing(
+    const std::vector<Segment>& segments,
+    const Ring& ring,
+    const QString& query,
+    const int origin) {
+  std::vector<int> hits;
+
+  forEachSnapshotRun(
+      ring.spans, segments, [&](const char16_t* data, const int length, const int start) {
+        findCharOccurrences(data, length, query.front(), start, hits);
+      });
+
+  // Anything after the first character has to match exactly, as when refining
+  for (qsizetype i = 1; i < query.length(); i++) {
+    std::erase_if(hits, [&](const int position) {
+      return characterIn(segments, position + int(i)) != query[i];
+    });
+  }
+
+  return mergeNearestFirst(hits, origin);
+}
+
+void TargetString::streamRings(
+    QPromise<std::vector<int>>& promise,
+    const std::shared_ptr<const std::vector<Segment>>& segments,
+    const std::shared_ptr<const std::vector<Ring>>& rings,
+    PendingRings pending,
+    const QString& query,
+    const int origin) {
+  const TraceScope trace("stream");
+
+  // One result per ring, empty or not, so the GUI side knows how far the scan has got
+  while (!pending.empty()) {
+    if (promise.isCanceled()) {
+      return;
+    }
+
+    promise.addResult(matchRing(*segments, (*rings)[pending.next++], query, origin));
+  }
+}
+
+void TargetString::scanVisible(std::vector<int>& positions) {
+  if (pendingVisible_.empty()) {
+    return;
+  }
+
+  const TraceScope trace("scanSlice");
+  const auto deadline = std::chrono::steady_clock::now() + kFrameBudget_;
+
+  // At least one ring per slice, so there's always progress
+  do {
+    const std::vector<int> hits =
+        matchRing(segments_, visibleRings_[pendingVisible_.next++], query_, origin_);
+    positions.insert(positions.end(), hits.begin(), hits.end());
+  } while (!pendingVisible_.empty() && std::chrono::steady_clock::now() < deadline);
+}
+
+void TargetString::continueScan() {
+  if (!pendingVisible_.empty()) {
+    // Let the editor repaint and take input before the next slice
+    scanTimer_.start();
+  } else if (!pendingOffscreen_.empty() && pendingOffscreen_.next >= snapshotRings_) {
+    emit offscreenTextWanted();
+  } else if (!pendingOffscreen_.empty()) {
+    // As far as the snapshot goes, the worker reading a copy of it while more is added
+    stream_.setFuture(QtConcurrent::run(
+        &streamPool_,
+        &TargetString::streamRings,
+        std::make_shared<const std::vector<Segment>>(segments_),
+        offscreenRings_,
+        PendingRings{.next = pendingOffscreen_.next, .end = snapshotRings_},
+        query_,
+        origin_));
+  }
+}
+
+void TargetString::snapshotOffscreen(const TextSource& source) {
+  // Already answered, or the scan has been cancelled since
+  if (pendingOffscreen_.empty() || pendingOffscreen_.next < snapshotRings_) {
+    return;
+  }
+
+  const TraceScope trace("snapshotOffscreen");
+
+  // Whole rings, nearest first, at least one of them
+  int copied = 0;
+
+  while (snapshotRings_ < offscreenRings_->size() && copied < kOffscreenBatch_) {
+    for (const TextSpan& span : (*offscreenRings_)[snapshotRings_].spans) {
+      extendSnapshot(source, span);
+      copied += span.end - span.start + 1;
+    }
+
+    snapshotRings_++;
+  }
+
+  continueScan();
+}
+
+void TargetString::scanNextSlice() {
+  scanVisible(streamed_);
+  continueScan();
+
+  // Labelled along with whatever other slices and rings come in before the next frame, all checked
+  // against the labels already on screen
+  if (!labelTimer_.isActive()) {
+    labelTimer_.start();
+  }
+}
+
+void TargetString::labelStreamedMatches() {
+  if (streamed_.empty()) {
+    return;
+  }
+
+  const TraceScope trace("labelStreamed");
+
+  // Labels on screen may be half typed already, so they stay as they are and the late matches only
+  // get keys nothing else uses. Both cases of a label are kept back, so no two labels on screen
+  // differ by case alone.
+  LabelAllocator<kNumLabelKeys> labels(alphabet_);
+  const qsizetype length = query_.length();
+
+  for (const Target selectable : selectables_) {
+    labels.forbid(selectable.selector.front());
+    labels.forbid(snapshotCharacterAt(selectable.position + length));
+  }
+
+  for (const Target potentialSelectable : potentialSelectables_) {
+    labels.forbid(snapshotCharacterAt(potentialSelectable.position + length));
+  }
+
+  for (const int position : streamed_) {
+    labels.forbid(snapshotCharacterAt(position + length));
+  }
+
+  // Everything streamed in is further away than the targets, so they stay nearest first. A late
+  // match whose next character is the key of a label on screen stays unlabelled, as typing that
+  // character picks the label.
+  const size_t numLabels = std::min(labels.freeCount(), streamed_.size());
+
+  labels.assign(numLabels, [&](const size_t i, const char key) {
+    selectables_.push(streamed_[i], QChar(QLatin1Char(key)));
+  });
+
+  for (size_t i = numLabels; i < streamed_.size(); i++) {
+    potentialSelectables_.push(streamed_[i], snapshotCharacterAt(streamed_[i]));
+  }
+
+  streamed_.clear();
+}
 
-  // Now, find characters the set of characters that don't follow any of the matching positions
-  std::vector<char> validCharChoices;
-  validCharChoices.insert(validCharChoices.end(), kKeyOrder_.begin(), kKeyOrder_.end());
+void TargetString::cancelScan() {
+  scanTimer_.stop();
+  // The worker stops after the ring it's on, whose result is dropped below along with any others
+  // not seen yet
+  stream_.cancel();
+
+  // Matches whose rings are no longer pending must not be lost with the timer
+  labelTimer_.stop();
+  labelStreamedMatches();
+
+  // Their rings are still pending, so the next scan covers them again
+  stream_.setFuture(QFuture<std::vector<int>>());
+}
+
+void TargetString::assignLabels(
+    const TextSource& source,
+    const std::vector<int>& matchingPositions) {
+  assignLabels(matchingPositions, [&](const int position) {
+    return characterAt(source, position);
+  });
+}
+
+template <typename CharAt>
+void TargetString::assignLabels(const std::vector<int>& matchingPositions, CharAt&& charAt) {
+  const TraceScope trace("assign");
+
+  selectables_.clear();
+  potentialSelectables_.clear();
+
+  // Now, find the set of characters that don't follow any of the matching positions
+  LabelAllocator<kNumLabelKeys> labels(alphabet_);
 
   for (const auto position : matchingPositions) {
-    std::erase(
-        validCharChoices,
-        doc->characterAt(position + aggregateQuery.length() + 1).toUpper().toLatin1());
-    std::erase(
-        validCharChoices,
-        doc->characterAt(position + aggregateQuery.length() + 1).toLower().toLatin1());
+    labels.forbid(charAt(position + query_.length()));
   }
 
   // Provide the initial set of selectables
-  for (size_t i = 0; i < validCharChoices.size() && i < matchingPositions.size(); i++) {
-    selectables.push_back(
-        Target{.position = matchingPositions[i], .selector = QString(validCharChoices[i])});
+  size_t numLabels = std::min(labels.freeCount(), matchingPositions.size());
+
+  if (multiKeyLabels_ && numLabels > 1 && numLabels < matchingPositions.size()) {
+    // Spread the free keys over key sequences so every match gets a label
+    std::array<char, kNumLabelKeys> keys;
+    labels.assign(numLabels, [&](const size_t i, const char key) { keys[i] = key; });
+
+    buildHintSequences(std::span(keys.data(), numLabels), matchingPositions, selectables_);
+
+    numLabels = matchingPositions.size();
+  } else {
+    labels.assign(numLabels, [&](const size_t i, const char key) {
+      selectables_.push(matchingPositions[i], QChar(QLatin1Char(key)));
+    });
   }
 
   // Backup the ambiguous ones for later
-  for (size_t i = validCharChoices.size(); i < matchingPositions.size(); i++) {
-    potentialSelectables.push_back(Target{
-        .position = matchingPositions[i],
-        .selector = QString(doc->characterAt(matchingPositions[i]))});
+  for (size_t i = numLabels; i < matchingPositions.size(); i++) {
+    potentialSelectables_.push(matchingPositions[i], charAt(matchingPositions[i]));
   }
-
-  aggregateQuery += query;
 }
 
-void TargetString::backspace(QPlainTextEdit* textEdit) {
-  if (query_.length()) {
-    const QString queryLessOne = query_.mid(0, query_.length() - 1);
+void TargetString::buildHintSequences(
+    const std::span<const char> keys,
+    const std::vector<int>& positions,
+    CandidateSet& hints) {
+  const size_t base = keys.size();
+  const size_t count = positions.size();
 
-    reset();
+  if (count <= base) {
+    for (size_t i = 0; i < count; i++) {
+      hints.push(positions[i], QChar(QLatin1Char(keys[i])));
+    }
 
-    for (const QChar c : queryLessOne) {
-      findMatchingPositions(textEdit, c, query_, selectables_, potentialSelectables_);
+    return;
+  }
+
+  // Find the shallowest complete tree with room for every target, then only expand as many of the
+  // nodes one level up as needed, taking the least convenient ones so near targets stay short
+  size_t prefixLength = 1;
+  size_t numPrefixes = base;
+
+  while (numPrefixes * base < count) {
+    numPrefixes *= base;
+    prefixLength++;
+  }
+
+  const size_t numExpanded = (count - numPrefixes + base - 2) / (base - 1);
+
+  // Room for the longest prefix and the key that expands it
+  QVarLengthArray<char16_t, 16> sequence(prefixLength + 1);
+  size_t next = 0;
+
+  auto setPrefix = [&](size_t index) {
+    for (size_t i = prefixLength; i-- > 0; index /= base) {
+      sequence[i] = char16_t(keys[index % base]);
     }
+  };
+
+  for (size_t i = 0; i < numPrefixes - numExpanded; i++) {
+    setPrefix(i);
+    hints.push(positions[next++], QStringView(sequence.data(), prefixLength));
+  }
+
+  for (size_t i = numPrefixes - numExpanded; i < numPrefixes && next < count; i++) {
+    setPrefix(i);
+
+    for (size_t k = 0; k < base && next < count; k++) {
+      sequence[prefixLength] = char16_t(keys[k]);
+      hints.push(positions[next++], QStringView(sequence.data(), prefixLength + 1));
+    }
+  }
+}
+
+CandidateSet TargetString::takeSpareSet() {
+  if (spareSets_.empty()) {
+    return CandidateSet();
+  }
+
+  CandidateSet set = std::move(spareSets_.back());
+  spareSets_.pop_back();
+  set.clear();
+  return set;
+}
+
+void TargetString::recycle(CandidateSet&& set) {
+  spareSets_.push_back(std::move(set));
+}
+
+void TargetString::backspace() {
+  if (selection_.length()) {
+    selection_.chop(1);
+  } else if (query_.length()) {
+    cancelScan();
+
+    query_.chop(1);
+    recycle(std::exchange(selectables_, std::move(generations_.back().selectables)));
+    recycle(
+        std::exchange(potentialSelectables_, std::move(generations_.back().potentialSelectables)));
+    pendingVisible_ = generations_.back().pendingVisible;
+    pendingOffscreen_ = generations_.back().pendingOffscreen;
+    generations_.pop_back();
+
+    // Whatever the shorter query hadn't scanned yet is still to do
+    continueScan();
   }
 }
 
@@ -129,26 +815,85 @@ const QString& TargetString::query() const {
   return query_;
 }
 
+void TargetString::setMultiKeyLabels(const bool enabled) {
+  multiKeyLabels_ = enabled;
+}
+
+void TargetString::setLabelAlphabet(const LabelAlphabet<kNumLabelKeys>& alphabet) {
+  alphabet_ = alphabet;
+}
+
+void TargetString::setBigramQuery(const bool enabled) {
+  bigramQuery_ = enabled;
+}
+
 void TargetString::reset() {
+  // Nothing is left to label
+  streamed_.clear();
+  cancelScan();
+
+  // The workers own what they read, so they are left to wind down on their own
+  if (prepared_) {
+    prepared_->table.cancel();
+    prepared_.reset();
+  }
+
+  index_ = nullptr;
+  searchRange_.reset();
+  boundaryJump_ = false;
+
   query_ = QString();
-  selectables_.clear();
-  potentialSelectables_.clear();
+  selection_ = QString();
+  // The spare sets only last the session, so one big jump doesn't hold on to its memory
+  selectables_ = CandidateSet();
+  potentialSelectables_ = CandidateSet();
+  generations_.clear();
+  spareSets_.clear();
+  matchingPositions_ = std::vector<int>();
+  visibleRings_.clear();
+  offscreenRings_.reset();
+  snapshotRings_ = 0;
+  pendingVisible_ = PendingRings();
+  pendingOffscreen_ = PendingRings();
+  segments_.clear();
 }
 
-const std::vector<TargetString::Target>& TargetString::selectables() const {
+const CandidateSet& TargetString::selectables() const {
   return selectables_;
 }
 
-const std::vector<TargetString::Target>& TargetString::potentialSelectables() const {
+const CandidateSet& TargetString::potentialSelectables() const {
   return potentialSelectables_;
 }
 
+const QString& TargetString::selection() const {
+  return selection_;
+}
+
 int TargetString::getPositionForCharSelection(const QChar& c) const {
-  for (const auto& selectable : selectables_) {
-    if (selectable.selector == c) {
+  const QString selector = selection_ + c;
+
+  for (const Target selectable : selectables_) {
+    if (selectable.selector == selector) {
       return selectable.position;
     }
   }
   return -1;
 }
+
+bool TargetString::extendSelection(const QChar& c) {
+  const QString prefix = selection_ + c;
+
+  for (const Target selectable : selectables_) {
+    if (selectable.selector.length() > prefix.length() && selectable.selector.startsWith(prefix)) {
+      selection_ = prefix;
+      return true;
+    }
+  }
+  return false;
+}
+
+void TargetString::clearSelection() {
+  selection_.clear();
+}
 } // namespace Qtmotion
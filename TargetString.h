@@ -1,46 +1,293 @@
 #pragma once
 
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <span>
+#include <unordered_map>
+
+#include <QFuture>
+#include <QFutureWatcher>
 #include <QObject>
+#include <QPointer>
+#include <QPromise>
+#include <QThreadPool>
+#include <QTimer>
 
-class QPlainTextEdit;
+#include "CandidateSet.h"
+#include "KeyLayout.h"
+#include "LabelAllocator.h"
+#include "MatchKernel.h"
+#include "TextSource.h"
 
 namespace Qtmotion {
-class TargetString {
+class DocumentIndex;
+
+class TargetString : public QObject {
+  Q_OBJECT
+
  public:
-  TargetString() = default;
+  TargetString();
+  ~TargetString() override;
+
+  // Snapshots the visible range and, with firstKeyTable, starts finding every character in it on a
+  // worker thread, so the first appendQuery can look its matches up instead of scanning if the
+  // worker is done. Sources that hand out views of their own storage must outlive the TargetString,
+  // as cancelled scans can still be reading them after reset().
+  void prepare(const TextSource& source, bool firstKeyTable);
+
+  // Looks the first key up in the index instead of scanning whenever it's up to date. The index
+  // can drop itself at any time, after which scans take over.
+  void setIndex(const DocumentIndex* index);
+
+  // Also finds the first key beyond the visible range, within range. The visible matches are
+  // labelled first and the rest stream in nearest first from a worker, unless the index can
+  // answer at once. The text beyond the screen is asked for with offscreenTextWanted().
+  void setSearchRange(const std::optional<TextSpan>& range);
+
+  // Copies the next batch of the search range out of the source and scans on into it
+  void snapshotOffscreen(const TextSource& source);
 
-  void appendQuery(QPlainTextEdit* textEdit, const QChar& query);
+  // Whether matches are still being scanned for, on screen or off. The GUI thread only ever scans
+  // for a frame's worth of time before returning to the event loop.
+  bool isSearching() const;
+
+  void appendQuery(const TextSource& source, const QChar& query);
+
+  // Labels every boundary of a kind on screen without waiting for a query. Keys that aren't labels
+  // then narrow the targets down by the characters starting at them. Call after prepare().
+  void jumpToBoundaries(const TextSource& source, Boundary boundary);
 
   void reset();
 
+  // Labels become prefix-free key sequences when there are more matches than free keys
+  void setMultiKeyLabels(bool enabled);
+
+  // The keys labels are handed out from, cheapest first
+  void setLabelAlphabet(const LabelAlphabet<kNumLabelKeys>& alphabet);
+
+  // Waits for a second key before matching, then labels only where the pair of characters occurs.
+  // Takes effect from the next prepare().
+  void setBigramQuery(bool enabled);
+
   const QString& query() const;
 
-  void backspace(QPlainTextEdit* textEdit);
+  void backspace();
 
-  struct Target {
-    int position;
-    QString selector;
-  };
+  using Target = CandidateSet::Candidate;
 
-  const std::vector<Target>& selectables() const;
-  const std::vector<Target>& potentialSelectables() const;
+  const CandidateSet& selectables() const;
+  const CandidateSet& potentialSelectables() const;
   int getPositionForCharSelection(const QChar& c) const;
 
+  // Reads from the snapshot of the visible range where possible
+  QChar characterAt(const TextSource& source, int position) const;
+
+  // Keys typed so far towards a multi-key label
+  const QString& selection() const;
+  bool extendSelection(const QChar& c);
+  void clearSelection();
+
+ signals:
+  // Matches from a later slice of the scan have been added to the targets
+  void candidatesChanged();
+
+  // The offscreen scan has caught up with the snapshot and waits for snapshotOffscreen()
+  void offscreenTextWanted();
+
  private:
-  static void findMatchingPositions(
-      QPlainTextEdit* textEdit,
-      const QChar& query,
-      QString& aggregateQuery,
-      std::vector<Target>& selectables,
-      std::vector<Target>& potentialSelectables);
-
-  static constexpr std::array<char, 52> kKeyOrder_ = {
-      'j', 'f', 'k', 'd', 'l', 's', 'a', 'h', 'g', 'u', 'r', 'n', 'v', 't', 'i', 'e', 'm', 'c',
-      'o', 'w', 'x', 'p', 'q', 'z', 'b', 'y', 'J', 'F', 'K', 'D', 'L', 'S', 'A', 'H', 'G', 'U',
-      'R', 'N', 'V', 'T', 'I', 'E', 'M', 'C', 'O', 'W', 'X', 'P', 'Q', 'Z', 'B', 'Y'};
+  void findMatchingPositions(const TextSource& source, const QChar& query);
+
+  // Labels matches nearest first with keys that don't continue the query, leaving the rest as
+  // potential selectables
+  void assignLabels(const TextSource& source, const std::vector<int>& matchingPositions);
+
+  // The same, reading the characters after each match with charAt(position)
+  template <typename CharAt>
+  void assignLabels(const std::vector<int>& matchingPositions, CharAt&& charAt);
+
+  // Labels every position with a prefix-free sequence of keys, nearest first getting the shortest
+  static void buildHintSequences(
+      std::span<const char> keys,
+      const std::vector<int>& positions,
+      CandidateSet& hints);
+
+  // A cleared set from the session's spares, which keep their capacity from earlier keystrokes
+  CandidateSet takeSpareSet();
+  void recycle(CandidateSet&& set);
+
+  // Copies the spans plus some lookahead out of the source so refinements don't need to go back
+  // to it, unless the source can hand out views of its own storage
+  void takeSnapshot(const TextSource& source, const std::vector<TextSpan>& spans);
+
+  // Adds whatever of range the snapshot doesn't hold yet, keeping what it already does
+  void extendSnapshot(const TextSource& source, const TextSpan& range);
+
+  // Contiguous runs of the source held in the snapshot, by position. The text views either the
+  // storage or the source's own memory.
+  struct Segment {
+    int start;
+    QString storage;
+    QStringView text;
+  };
+
+  // Ascending positions of each character in the snapshot keyed by its lowercase form, or in
+  // bigram mode of each pair keyed by the lowercase form of the first and the second as it is
+  using FirstKeyTable = std::unordered_map<char32_t, std::vector<int>>;
+
+  static constexpr char32_t bigramKey(const char16_t folded, const char16_t second) {
+    return (char32_t(folded) << 16) | second;
+  }
+
+  // The table for the spans within one segment. Runs on a worker, which holds a copy of the
+  // segment and so shares its storage, which outlives ours.
+  static FirstKeyTable buildFirstKeyTable(
+      const std::vector<TextSpan>& spans,
+      const Segment& segment,
+      bool bigrams);
+
+  // The first query's matches from the table nearest first, with the same case rules as a scan
+  std::vector<int> lookupFirstKey(
+      const TextSource& source,
+      const FirstKeyTable& table,
+      const QString& query) const;
+
+  // Drops the positions of folded candidates that query doesn't match, by case for its first
+  // character and exactly for the rest
+  std::vector<int> keepMatchingCase(
+      const TextSource& source,
+      std::vector<int> folded,
+      const QString& query) const;
+
+  // The snapshot's character at position, or null when it doesn't hold it
+  QChar snapshotCharacterAt(int position) const;
+  static QChar characterIn(const std::vector<Segment>& segments, int position);
+
+  // The parts of some spans at the same distance band from the origin, on either side of it.
+  // Scanning rings in order finds matches nearest first, and lets a scan stop and resume anywhere.
+  struct Ring {
+    std::vector<TextSpan> spans;
+  };
+
+  static std::vector<Ring> buildRings(const std::vector<TextSpan>& spans, int origin, int chunk);
+
+  // The rings still to scan, as indices into those built for the first key. Generations only
+  // need to remember how far along they were, so keystrokes don't copy the rings themselves.
+  struct PendingRings {
+    size_t next = 0;
+    size_t end = 0;
+
+    bool empty() const {
+      return next == end;
+    }
+  };
+
+  // Nearest first positions in the ring where the whole query matches
+  static std::vector<int> matchRing(
+      const std::vector<Segment>& segments,
+      const Ring& ring,
+      const QString& query,
+      int origin);
+
+  // Runs on a worker, reporting the matches of each pending ring in turn until cancelled. It
+  // shares what it reads, so a cancelled scan can finish its ring after a new one has started, or
+  // the jump has ended.
+  static void streamRings(
+      QPromise<std::vector<int>>& promise,
+      const std::shared_ptr<const std::vector<Segment>>& segments,
+      const std::shared_ptr<const std::vector<Ring>>& rings,
+      PendingRings pending,
+      const QString& query,
+      int origin);
+
+  // Scans pending visible rings until the frame budget runs out, appending their matches
+  void scanVisible(std::vector<int>& positions);
+
+  // Schedules the next visible slice, or hands the offscreen rings to a worker once those are done
+  void continueScan();
+
+  void scanNextSlice();
+
+  // Adds the late matches after the targets, labelling them with whatever keys are still free
+  void labelStreamedMatches();
+
+  // Stops scanning straight away, leaving the unscanned rings pending
+  void cancelScan();
+
+  // Calls fn(data, length, position) for the part of each span held in the snapshot, in more than
+  // one run where a span crosses from one segment into the next
+  template <typename Fn>
+  static void forEachSnapshotRun(
+      const std::vector<TextSpan>& spans,
+      const std::vector<Segment>& segments,
+      Fn&& fn);
+
+  // Where targets spread out from, which is the middle of the screen when the cursor is offscreen
+  static int jumpOrigin(const std::vector<TextSpan>& spans, int cursorPos);
+
+  // Candidates and their labels as they were before a query character was appended
+  struct Generation {
+    CandidateSet selectables;
+    CandidateSet potentialSelectables;
+    PendingRings pendingVisible;
+    PendingRings pendingOffscreen;
+  };
+
+  // What the source looked like when prepare() snapshotted it, and the table built from that
+  struct Prepared {
+    std::vector<TextSpan> spans;
+    int origin;
+    int revision;
+    bool bigrams;
+    // Not started when there's an index to use instead
+    QFuture<FirstKeyTable> table;
+  };
+
+  // How much of each side of the origin makes up a ring, on screen and off
+  static constexpr int kScanChunk_ = 4 * 1024;
+  static constexpr int kStreamChunk_ = 64 * 1024;
+
+  // How long the GUI thread scans for before letting the editor have a frame
+  static constexpr std::chrono::microseconds kFrameBudget_{2000};
+
+  // How far past the visible range the snapshot reaches for long queries, beyond which we fall
+  // back to reading the source
+  static constexpr int kSnapshotLookahead_ = 256;
+
+  // How much offscreen text is copied out of the source at a time, between frames
+  static constexpr int kOffscreenBatch_ = 1024 * 1024;
 
+  LabelAlphabet<kNumLabelKeys> alphabet_ = kQwertyAlphabet;
+  bool multiKeyLabels_ = false;
+  bool bigramQuery_ = false;
+  // The targets came from jumpToBoundaries(), so every key refines them
+  bool boundaryJump_ = false;
   QString query_;
-  std::vector<Target> selectables_;
-  std::vector<Target> potentialSelectables_;
+  QString selection_;
+  CandidateSet selectables_;
+  CandidateSet potentialSelectables_;
+  std::vector<Generation> generations_;
+  std::vector<CandidateSet> spareSets_;
+  // Reused by every keystroke for the matches before they're labelled
+  std::vector<int> matchingPositions_;
+  std::vector<Segment> segments_;
+  std::optional<Prepared> prepared_;
+  QPointer<const DocumentIndex> index_;
+  std::optional<TextSpan> searchRange_;
+  int origin_ = 0;
+  std::vector<Ring> visibleRings_;
+  std::shared_ptr<const std::vector<Ring>> offscreenRings_;
+  // How many of the offscreen rings the snapshot holds, always the nearest ones
+  size_t snapshotRings_ = 0;
+  PendingRings pendingVisible_;
+  PendingRings pendingOffscreen_;
+  // Matches streamed in since the targets were last labelled, which happens at most once a frame
+  std::vector<int> streamed_;
+  QTimer labelTimer_;
+  QTimer scanTimer_;
+  QFutureWatcher<std::vector<int>> stream_;
+  // Sources that can be viewed in place may still be read by cancelled scans until these are done,
+  // so they're waited for with the last of the jumps rather than with each one
+  QThreadPool streamPool_;
 };
 } // namespace Qtmotion
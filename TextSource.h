@@ -0,0 +1,40 @@
+#pragma once
+
+#include <vector>
+
+#include <QChar>
+#include <QString>
+#include <QStringView>
+
+namespace Qtmotion {
+// An inclusive range of text positions
+struct TextSpan {
+  int start;
+  int end;
+
+  bool operator==(const TextSpan&) const = default;
+};
+
+// Everything the jump engine needs to read from the text it searches, so it can run against an
+// editor or a plain buffer alike. Positions follow QTextDocument, with a paragraph separator
+// between blocks.
+class TextSource {
+ public:
+  virtual ~TextSource() = default;
+
+  // The on-screen fragments of text, in position order
+  virtual std::vector<TextSpan> visibleSpans() const = 0;
+
+  virtual int cursorPosition() const = 0;
+
+  // Changes whenever the text does, so snapshots can tell when they're stale
+  virtual int revision() const = 0;
+
+  // Null past the end of the text
+  virtual QChar characterAt(int position) const = 0;
+
+  // Up to length characters from position, either viewing the source's own storage directly or
+  // copied into scratch when the source has no contiguous storage to view
+  virtual QStringView characters(int position, int length, QString& scratch) const = 0;
+};
+} // namespace Qtmotion
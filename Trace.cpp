@@ -0,0 +1,109 @@
+#include "Trace.h"
+
+#include <mutex>
+#include <vector>
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFile>
+#include <QThread>
+
+Q_LOGGING_CATEGORY(qtmotionTrace, "qtmotion.trace", QtWarningMsg)
+
+namespace Qtmotion {
+namespace {
+struct TraceEvent {
+  const char* name;
+  std::chrono::steady_clock::time_point start;
+  std::chrono::steady_clock::time_point end;
+  quintptr thread;
+};
+
+// Enough between flushes without letting a forgotten logging rule grow without bound
+constexpr size_t kMaxEvents = 1 << 20;
+
+std::mutex eventsMutex;
+std::vector<TraceEvent> events;
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// Whether this run has written to the trace file yet, which only flushTrace() touches
+bool fileStarted = false;
+} // namespace
+
+TraceScope::TraceScope(const char* name) {
+  if (qtmotionTrace().isDebugEnabled()) {
+    name_ = name;
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+TraceScope::~TraceScope() {
+  if (name_ == nullptr) {
+    return;
+  }
+
+  const auto end = std::chrono::steady_clock::now();
+  const std::lock_guard lock(eventsMutex);
+
+  if (events.size() < kMaxEvents) {
+    events.push_back(TraceEvent{
+        .name = name_,
+        .start = start_,
+        .end = end,
+        .thread = quintptr(QThread::currentThreadId())});
+  }
+}
+
+void flushTrace() {
+  if (!qtmotionTrace().isDebugEnabled()) {
+    return;
+  }
+
+  // Scopes on other threads only wait for the swap, not for the file
+  std::vector<TraceEvent> flushed;
+
+  {
+    const std::lock_guard lock(eventsMutex);
+    flushed.swap(events);
+  }
+
+  if (flushed.empty()) {
+    return;
+  }
+
+  const QString path = QDir::temp().filePath("qtmotion-trace.json");
+  QFile file(path);
+
+  if (!file.open(QIODevice::WriteOnly | (fileStarted ? QIODevice::Append : QIODevice::Truncate))) {
+    qCWarning(qtmotionTrace) << "Could not write trace to" << path;
+    return;
+  }
+
+  auto micros = [](const std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::micro>(duration).count();
+  };
+
+  const qint64 pid = QCoreApplication::applicationPid();
+  // The array format may be left open, so later flushes can append to it
+  QByteArray json = fileStarted ? "" : "[\n";
+
+  for (size_t i = 0; i < flushed.size(); i++) {
+    const TraceEvent& event = flushed[i];
+    json += QStringLiteral(
+                "%1{\"name\":\"%2\",\"cat\":\"qtmotion\",\"ph\":\"X\",\"ts\":%3,\"dur\":%4,"
+                "\"pid\":%5,\"tid\":%6}\n")
+                .arg(QLatin1String(fileStarted || i > 0 ? "," : ""))
+                .arg(QLatin1String(event.name))
+                .arg(micros(event.start - epoch), 0, 'f', 3)
+                .arg(micros(event.end - event.start), 0, 'f', 3)
+                .arg(pid)
+                .arg(event.thread)
+                .toUtf8();
+  }
+
+  file.write(json);
+  fileStarted = true;
+
+  qCDebug(qtmotionTrace) << "Wrote" << flushed.size() << "trace events to" << path;
+}
+} // namespace Qtmotion
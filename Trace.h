@@ -0,0 +1,29 @@
+#pragma once
+
+#include <chrono>
+
+#include <QLoggingCategory>
+
+Q_DECLARE_LOGGING_CATEGORY(qtmotionTrace)
+
+namespace Qtmotion {
+// Records how long the enclosing scope took as a Chrome trace event, while debug output is enabled
+// for the qtmotion.trace logging category. Otherwise it costs a flag check.
+class TraceScope {
+ public:
+  // name must outlive the trace, e.g. a string literal
+  explicit TraceScope(const char* name);
+  ~TraceScope();
+
+  TraceScope(const TraceScope&) = delete;
+  TraceScope& operator=(const TraceScope&) = delete;
+
+ private:
+  const char* name_ = nullptr;
+  std::chrono::steady_clock::time_point start_;
+};
+
+// Appends the events recorded since the last flush to the trace file, loadable in chrome://tracing
+// or Perfetto. The first flush of a run starts the file afresh.
+void flushTrace();
+} // namespace Qtmotion
@@ -0,0 +1,418 @@
+// Headless benchmark for the jump engine. Drives TargetString against offscreen QPlainTextEdits
+// loaded with synthetic corpora, plus any files passed on the command line, and reports
+// per-keystroke latency percentiles and heap allocation counts, both to the first labelled slice
+// and to the end of the scan. Editor corpora are run a second time with a DocumentIndex answering
+// the first key.
+//
+// Files passed with --mapped are UTF-16 and read through a memory mapping rather than an editor,
+// with a window of them treated as the visible range.
+//
+//   QtmotionBench [--sessions N] [--mapped utf16-file]... [file...]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <limits>
+#include <map>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <QApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QPlainTextEdit>
+#include <QScrollBar>
+#include <QTextDocument>
+#include <QThread>
+
+#include "DocumentIndex.h"
+#include "MappedFileSource.h"
+#include "PlainTextEditSource.h"
+#include "TargetString.h"
+#include "Trace.h"
+
+namespace {
+std::atomic<size_t> allocations = 0;
+} // namespace
+
+#if defined(__GLIBC__)
+// Qt containers allocate through malloc and realloc rather than operator new, so count at the C
+// allocator, which operator new also ends up in
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+
+void* malloc(const size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_malloc(size);
+}
+
+void* calloc(const size_t count, const size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_calloc(count, size);
+}
+
+void* realloc(void* p, const size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  return __libc_realloc(p, size);
+}
+}
+#else
+// Elsewhere only operator new can be replaced portably, which misses Qt's own containers
+void* operator new(const size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+
+  if (void* p = std::malloc(size ? size : 1)) {
+    return p;
+  }
+
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+  std::free(p);
+}
+#endif
+
+namespace Qtmotion {
+namespace {
+struct Corpus {
+  std::string name;
+  QString text;
+  bool wrap;
+};
+
+struct Samples {
+  std::vector<double> micros;
+  std::vector<size_t> allocations;
+};
+
+QString denseCpp(const int lines) {
+  std::mt19937 rng(1);
+  const std::vector<QString> identifiers = {
+      "textEdit", "selectables_", "QTextCursor", "position", "std::vector<int>", "query_", "kKey"};
+  QString text;
+
+  for (int i = 0; i < lines; i++) {
+    text += QString("  if (%1[%2] != %3->%4(%5)) { return %6 + %7; }\n")
+                .arg(identifiers[rng() % identifiers.size()])
+                .arg(rng() % 100)
+                .arg(identifiers[rng() % identifiers.size()])
+                .arg(identifiers[rng() % identifiers.size()])
+                .arg(rng() % 1000)
+                .arg(identifiers[rng() % identifiers.size()])
+                .arg(rng() % 10);
+  }
+
+  return text;
+}
+
+QString minifiedJs(const int statements) {
+  std::mt19937 rng(2);
+  QString text;
+
+  for (int i = 0; i < statements; i++) {
+    text += QString("var a%1=function(b,c){return b.e%2(c)&&c[%3]||null};")
+                .arg(i)
+                .arg(rng() % 50)
+                .arg(rng() % 100);
+  }
+
+  return text;
+}
+
+QString sourceLines(const int lines) {
+  QString text;
+
+  for (int i = 0; i < lines; i++) {
+    text += QString("int value%1 = compute(%1, \"line %1\"); // trailing comment\n").arg(i);
+  }
+
+  return text;
+}
+
+using Clock = std::chrono::steady_clock;
+
+void record(Samples& samples, const Clock::time_point start, const size_t allocationsBefore) {
+  const auto end = Clock::now();
+  samples.micros.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+  samples.allocations.push_back(allocations.load(std::memory_order_relaxed) - allocationsBefore);
+}
+
+template <typename Fn>
+void measure(Samples& samples, Fn&& fn) {
+  const size_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+  const auto start = Clock::now();
+  fn();
+  record(samples, start, allocationsBefore);
+}
+
+// Times a key up to its first slice, as name, and then runs the event loop as the editor would
+// until the rest of the scan is in and labelled, as name+scan
+template <typename Fn>
+void measureKey(
+    std::map<std::string, Samples>& results,
+    const std::string& name,
+    const TargetString& target,
+    Fn&& fn) {
+  const size_t allocationsBefore = allocations.load(std::memory_order_relaxed);
+  const auto start = Clock::now();
+  fn();
+  record(results[name], start, allocationsBefore);
+
+  while (target.isSearching()) {
+    QApplication::processEvents();
+  }
+
+  // The last matches are labelled on the next pass through the event loop
+  QApplication::processEvents();
+  record(results[name + "+scan"], start, allocationsBefore);
+}
+
+double percentile(std::vector<double> values, const double p) {
+  if (values.empty()) {
+    return 0;
+  }
+
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, size_t(p * (values.size() - 1) + 0.5))];
+}
+
+void report(const std::string& corpus, const std::map<std::string, Samples>& results) {
+  for (const auto& [operation, samples] : results) {
+    double meanAllocations = 0;
+
+    for (const size_t count : samples.allocations) {
+      meanAllocations += double(count) / samples.allocations.size();
+    }
+
+    std::printf(
+        "%-26s %-18s %6zu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+        corpus.c_str(),
+        operation.c_str(),
+        samples.micros.size(),
+        percentile(samples.micros, 0.5),
+        percentile(samples.micros, 0.9),
+        percentile(samples.micros, 0.99),
+        percentile(samples.micros, 1.0),
+        meanAllocations);
+  }
+}
+
+void runSession(
+    const TextSource& source,
+    const DocumentIndex* index,
+    const int session,
+    std::mt19937& rng,
+    std::map<std::string, Samples>& results) {
+  static const std::vector<QChar> firstKeys = {'e', 't', 'a', '_', 'c', 'S', '('};
+
+  TargetString target;
+  const QChar first = firstKeys[session % firstKeys.size()];
+
+  target.setIndex(index);
+
+  // The first key lands before the worker is done, so this measures the scan it falls back to
+  measure(results["prepare"], [&] { target.prepare(source, true); });
+  measureKey(results, "appendQuery#1", target, [&] { target.appendQuery(source, first); });
+
+  // Refine towards a match that couldn't be labelled yet, as a user would
+  if (!target.potentialSelectables().empty()) {
+    const auto& potentials = target.potentialSelectables();
+    const int position = potentials[rng() % potentials.size()].position;
+    const QChar next = target.characterAt(source, position + 1);
+
+    measureKey(results, "appendQuery#2", target, [&] { target.appendQuery(source, next); });
+    measureKey(results, "backspace", target, [&] { target.backspace(); });
+  }
+
+  if (!target.selectables().empty()) {
+    const QChar label = target.selectables().front().selector.front();
+    measure(results["selection"], [&] { target.getPositionForCharSelection(label); });
+  }
+}
+
+// Types the pair of characters at a random visible position, as a bigram jump would
+void runBigramSession(
+    const TextSource& source,
+    std::mt19937& rng,
+    std::map<std::string, Samples>& results) {
+  const std::vector<TextSpan> spans = source.visibleSpans();
+
+  if (spans.empty()) {
+    return;
+  }
+
+  const TextSpan& span = spans[rng() % spans.size()];
+  const int position = span.start + int(rng() % uint32_t(span.end - span.start + 1));
+
+  TargetString target;
+  target.setBigramQuery(true);
+
+  measure(results["prepare"], [&] { target.prepare(source, true); });
+  measureKey(results, "appendQuery#1", target, [&] {
+    target.appendQuery(source, source.characterAt(position));
+  });
+  measureKey(results, "appendQuery#2", target, [&] {
+    target.appendQuery(source, source.characterAt(position + 1));
+  });
+
+  if (!target.selectables().empty()) {
+    const QChar label = target.selectables().front().selector.front();
+    measure(results["selection"], [&] { target.getPositionForCharSelection(label); });
+  }
+}
+
+void run(const Corpus& corpus, const int sessions) {
+  QPlainTextEdit textEdit;
+  textEdit.resize(1600, 1200);
+  textEdit.setLineWrapMode(corpus.wrap ? QPlainTextEdit::WidgetWidth : QPlainTextEdit::NoWrap);
+  textEdit.setPlainText(corpus.text);
+  textEdit.show();
+  QApplication::processEvents();
+
+  const PlainTextEditSource source(&textEdit);
+
+  for (const bool indexed : {false, true}) {
+    const DocumentIndex* index = indexed
+        ? DocumentIndex::attach(textEdit.document(), std::numeric_limits<qint64>::max())
+        : nullptr;
+
+    // An editor would have finished indexing long before the first jump
+    while (index && !index->isIdle()) {
+      QThread::msleep(1);
+    }
+
+    std::mt19937 rng(3);
+    std::map<std::string, Samples> results;
+
+    for (int session = 0; session < sessions; session++) {
+      // Somewhere new in the document each session, with the cursor on screen
+      QScrollBar* scrollBar = textEdit.verticalScrollBar();
+      scrollBar->setValue(scrollBar->minimum() + rng() % (scrollBar->maximum() + 1));
+      QApplication::processEvents();
+
+      const QPoint middle(textEdit.viewport()->width() / 2, textEdit.viewport()->height() / 2);
+      textEdit.setTextCursor(textEdit.cursorForPosition(middle));
+
+      runSession(source, index, session, rng, results);
+    }
+
+    report(indexed ? corpus.name + "+index" : corpus.name, results);
+  }
+
+  std::mt19937 rng(3);
+  std::map<std::string, Samples> results;
+
+  for (int session = 0; session < sessions; session++) {
+    QScrollBar* scrollBar = textEdit.verticalScrollBar();
+    scrollBar->setValue(scrollBar->minimum() + rng() % (scrollBar->maximum() + 1));
+    QApplication::processEvents();
+
+    runBigramSession(source, rng, results);
+  }
+
+  report(corpus.name + "+bigram", results);
+}
+
+void runMapped(const QString& path, const int sessions) {
+  MappedFileSource source(path);
+
+  if (!source.isOpen()) {
+    std::fprintf(stderr, "Could not map %s\n", qPrintable(path));
+    return;
+  }
+
+  // Roughly what a tall editor shows of dense code
+  constexpr int kWindow = 16 * 1024;
+  std::mt19937 rng(4);
+  std::map<std::string, Samples> results;
+
+  for (int session = 0; session < sessions; session++) {
+    const int start = int(rng() % uint32_t(std::max(source.length() - kWindow, 1)));
+    source.setVisibleRange(start, start + kWindow - 1);
+    source.setCursorPosition(start + kWindow / 2);
+
+    runSession(source, nullptr, session, rng, results);
+  }
+
+  report(QFileInfo(path).fileName().toStdString(), results);
+}
+} // namespace
+} // namespace Qtmotion
+
+int main(int argc, char* argv[]) {
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  }
+
+  QApplication app(argc, argv);
+
+  int sessions = 200;
+  std::vector<Qtmotion::Corpus> corpora = {
+      {.name = "dense-cpp", .text = Qtmotion::denseCpp(20000), .wrap = true},
+      {.name = "minified-js", .text = Qtmotion::minifiedJs(50000), .wrap = true},
+      {.name = "minified-js-nowrap", .text = Qtmotion::minifiedJs(50000), .wrap = false},
+      {.name = "100k-lines", .text = Qtmotion::sourceLines(100000), .wrap = true},
+  };
+
+  QStringList mapped;
+  const QStringList args = app.arguments();
+
+  for (int i = 1; i < args.size(); i++) {
+    if (args[i] == "--sessions" && i + 1 < args.size()) {
+      sessions = args[++i].toInt();
+      continue;
+    }
+
+    if (args[i] == "--mapped" && i + 1 < args.size()) {
+      mapped.push_back(args[++i]);
+      continue;
+    }
+
+    QFile file(args[i]);
+
+    if (!file.open(QIODevice::ReadOnly)) {
+      std::fprintf(stderr, "Could not read %s\n", qPrintable(args[i]));
+      return 1;
+    }
+
+    corpora.push_back(Qtmotion::Corpus{
+        .name = QFileInfo(args[i]).fileName().toStdString(),
+        .text = QString::fromUtf8(file.readAll()),
+        .wrap = true});
+  }
+
+  std::printf(
+      "%-26s %-18s %6s %10s %10s %10s %10s %10s\n",
+      "corpus",
+      "operation",
+      "n",
+      "p50 (us)",
+      "p90 (us)",
+      "p99 (us)",
+      "max (us)",
+      "allocs");
+
+  for (const auto& corpus : corpora) {
+    Qtmotion::run(corpus, sessions);
+  }
+
+  for (const QString& path : mapped) {
+    Qtmotion::runMapped(path, sessions);
+  }
+
+  Qtmotion::flushTrace();
+
+  return 0;
+}